@@ -0,0 +1,62 @@
+# Generates translation units with SIZES literals and compiles each of them with every compiler in
+# COMPILERS, using MEASURE to report the frontend time and peak memory. Only the frontend runs
+# (-fsyntax-only), so the numbers are not affected by code generation.
+#
+# cmake -DMEASURE=... -DCOMPILERS=... -DSIZES=... -DINCLUDE_DIRS=... -DOUTPUT_DIR=...
+#       -P compile_benchmark.cmake
+
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+
+set(include_flags)
+foreach(dir IN LISTS INCLUDE_DIRS)
+  if(dir)
+    list(APPEND include_flags "-I${dir}")
+  endif()
+endforeach()
+
+# Every fourth literal has a context and every third one plural forms, so all paths of the literal
+# parser are covered.
+function(generate_literals size file)
+  set(content "#include <i18n/simple.hpp>\n\nusing namespace mfk::i18n::literals;\n\n")
+  string(APPEND content "std::string_view message(int i, unsigned long n) {\n  switch (i) {\n")
+  math(EXPR last "${size} - 1")
+  foreach(i RANGE ${last})
+    math(EXPR context "${i} % 4")
+    math(EXPR plural "${i} % 3")
+    set(literal "Message ${i} of the benchmark")
+    if(plural EQUAL 0)
+      set(literal "${literal} with ${i} (item|items) and some file(s)")
+    endif()
+    if(context EQUAL 0)
+      set(literal "context ${i}|${literal}")
+    endif()
+    if(plural EQUAL 0)
+      string(APPEND content "  case ${i}: return \"${literal}\"_[n];\n")
+    else()
+      string(APPEND content "  case ${i}: return \"${literal}\"_;\n")
+    endif()
+  endforeach()
+  string(APPEND content "  }\n  return {};\n}\n")
+  file(WRITE "${file}" "${content}")
+endfunction()
+
+message(STATUS "literals  compiler  frontend time  peak memory")
+foreach(size IN LISTS SIZES)
+  set(file "${OUTPUT_DIR}/literals_${size}.cpp")
+  if(NOT EXISTS "${file}")
+    generate_literals(${size} "${file}")
+  endif()
+  foreach(compiler IN LISTS COMPILERS)
+    get_filename_component(name "${compiler}" NAME)
+    execute_process(
+      COMMAND "${MEASURE}" "${compiler}" -std=c++20 -fsyntax-only ${include_flags} "${file}"
+      OUTPUT_VARIABLE result
+      RESULT_VARIABLE status
+      OUTPUT_STRIP_TRAILING_WHITESPACE)
+    if(NOT status EQUAL 0)
+      message(SEND_ERROR "${name} failed to compile ${file}")
+      continue()
+    endif()
+    message(STATUS "${size}  ${name}  ${result}")
+  endforeach()
+endforeach()
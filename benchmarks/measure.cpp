@@ -0,0 +1,36 @@
+// Runs a command and prints its wall clock time and peak memory usage, e.g. "12.34 s 567 MiB".
+// The output is used by compile_benchmark.cmake.
+
+#include <chrono>
+#include <cstdio>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s command [args...]\n", argv[0]);
+    return 2;
+  }
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid  = fork();
+  if (pid < 0) {
+    std::perror("fork");
+    return 2;
+  }
+  if (pid == 0) {
+    execvp(argv[1], argv + 1);
+    std::perror(argv[1]);
+    _exit(127);
+  }
+  int status;
+  struct rusage usage {};
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    std::perror("wait4");
+    return 2;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  // ru_maxrss is given in KiB on Linux
+  std::printf("%.2f s %ld MiB\n", elapsed.count(), usage.ru_maxrss / 1024);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
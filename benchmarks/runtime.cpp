@@ -0,0 +1,333 @@
+// Measures the runtime cost of translations, plural selection and formatting, with libintl (the
+// default backend) and with MoBackend, and compares them to calling dgettext directly. Every
+// benchmark also reports the number of heap allocations per operation.
+//
+// The German catalogs from tests/ are used for the translated cases. libintl ignores LANGUAGE in
+// the C locale, so C.UTF-8 is used if de_DE.UTF-8 is not installed. The catalog size benchmarks
+// write synthetic catalogs with 10 to 1M entries to a temporary directory.
+
+#include <i18n/mo.hpp>
+#include <i18n/simple.hpp>
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+using namespace mfk::i18n::literals;
+using mfk::i18n::I18NStringCrossDomain;
+using mfk::i18n::Locale;
+using mfk::i18n::MoBackend;
+
+namespace {
+thread_local std::uint64_t allocations = 0;
+} // namespace
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (void *memory = std::malloc(size ? size : 1)) return memory;
+  throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+namespace {
+
+// Counts the allocations of the calling thread during the timed loop.
+class AllocationCounter {
+ public:
+  explicit AllocationCounter(benchmark::State &state): state(state), start(allocations) {}
+  ~AllocationCounter() {
+    state.counters["allocs/op"] =
+        benchmark::Counter(double(allocations - start), benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State &state;
+  std::uint64_t start;
+};
+
+// Switches libintl to German, or to the C locale if translated is false.
+bool use_gettext(bool translated) {
+  bindtextdomain("testcases", TEST_SOURCE_DIR);
+  textdomain("testcases");
+  if (!translated) return std::setlocale(LC_ALL, "C");
+  setenv("LANGUAGE", "de_DE", 1);
+  return std::setlocale(LC_ALL, "de_DE.UTF-8") || std::setlocale(LC_ALL, "C.UTF-8");
+}
+
+const Locale &german() {
+  static const Locale locale("de_DE", {{"testcases", TEST_SOURCE_DIR}}, "testcases");
+  return locale;
+}
+const Locale &untranslated() {
+  static const Locale locale;
+  return locale;
+}
+
+void check(benchmark::State &state, std::string_view result, std::string_view expected) {
+  if (result != expected)
+    state.SkipWithError(("unexpected translation " + std::string(result)).c_str());
+}
+
+void literal_gettext(benchmark::State &state, bool translated) {
+  if (!use_gettext(translated)) return state.SkipWithError("no suitable locale installed");
+  check(state, "Hello world!"_, translated ? "Hallo Welt!" : "Hello world!");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(static_cast<const char *>("Hello world!"_));
+}
+BENCHMARK_CAPTURE(literal_gettext, C, false);
+BENCHMARK_CAPTURE(literal_gettext, de_DE, true);
+
+void literal_mo(benchmark::State &state, const Locale &(*locale)()) {
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("Hello world!"_.in(locale()).view().data());
+}
+BENCHMARK_CAPTURE(literal_mo, C, untranslated);
+BENCHMARK_CAPTURE(literal_mo, de_DE, german);
+
+void raw_dgettext(benchmark::State &state, bool translated) {
+  if (!use_gettext(translated)) return state.SkipWithError("no suitable locale installed");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(dgettext("testcases", "Hello world!"));
+}
+BENCHMARK_CAPTURE(raw_dgettext, C, false);
+BENCHMARK_CAPTURE(raw_dgettext, de_DE, true);
+
+void plural_gettext(benchmark::State &state) {
+  if (!use_gettext(true)) return state.SkipWithError("no suitable locale installed");
+  unsigned long n = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("I ate {} apple(s)."_[n++ & 3]);
+}
+BENCHMARK(plural_gettext);
+
+void plural_mo(benchmark::State &state) {
+  unsigned long n = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("I ate {} apple(s)."_.in(german())[n++ & 3]);
+}
+BENCHMARK(plural_mo);
+
+void raw_dngettext(benchmark::State &state) {
+  if (!use_gettext(true)) return state.SkipWithError("no suitable locale installed");
+  unsigned long n = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        dngettext("testcases", "I ate {} apple.", "I ate {} apples.", n++ & 3));
+}
+BENCHMARK(raw_dngettext);
+
+void format_gettext(benchmark::State &state) {
+  if (!use_gettext(true)) return state.SkipWithError("no suitable locale installed");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("Hello {}!"_("Max"));
+}
+BENCHMARK(format_gettext);
+
+void format_mo(benchmark::State &state) {
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("Hello {}!"_.in(german())("Max"));
+}
+BENCHMARK(format_mo);
+
+void format_plural_mo(benchmark::State &state) {
+  unsigned long n = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("I ate {} apple(s)."_.in(german())(n++ & 3));
+}
+BENCHMARK(format_plural_mo);
+
+void cross_domain_gettext(benchmark::State &state) {
+  if (!use_gettext(true)) return state.SkipWithError("no suitable locale installed");
+  I18NStringCrossDomain message("testcases", "Hello world!", "Hello world!");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(static_cast<const char *>(message));
+}
+BENCHMARK(cross_domain_gettext);
+
+void cross_domain_mo(benchmark::State &state) {
+  I18NStringCrossDomain message("testcases", "Hello world!", "Hello world!");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(message.in(german()).view().data());
+}
+BENCHMARK(cross_domain_mo);
+
+// The same lookups from several threads at once.
+void contended_gettext(benchmark::State &state) {
+  if (state.thread_index() == 0 && !use_gettext(true))
+    return state.SkipWithError("no suitable locale installed");
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(static_cast<const char *>("Hello world!"_));
+}
+BENCHMARK(contended_gettext)->ThreadRange(1, 16)->UseRealTime();
+
+void contended_mo(benchmark::State &state) {
+  if (state.thread_index() == 0 && MoBackend::locale().languages() != "de_DE") {
+    MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+    MoBackend::textdomain("testcases");
+    MoBackend::set_language("de_DE");
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state)
+    benchmark::DoNotOptimize("Hello world!"_.in(MoBackend::locale()).view().data());
+}
+BENCHMARK(contended_mo)->ThreadRange(1, 16)->UseRealTime();
+
+// Synthetic catalogs with "message <i>" translated to "Nachricht <i>", written in the format of
+// msgfmt, including the hash table used by libintl and MoFile.
+class SyntheticCatalogs {
+ public:
+  SyntheticCatalogs():
+      root(std::filesystem::temp_directory_path()
+           / ("i18n-benchmark-" + std::to_string(::getpid()))) {}
+  SyntheticCatalogs(const SyntheticCatalogs &)            = delete;
+  SyntheticCatalogs &operator=(const SyntheticCatalogs &) = delete;
+  ~SyntheticCatalogs() {
+    std::error_code error;
+    std::filesystem::remove_all(root, error);
+  }
+
+  // The domain of the catalog with size entries, which is written on first use.
+  std::string domain(std::uint32_t size) {
+    std::string name = "bench" + std::to_string(size);
+    if (written.emplace(size).second) {
+      std::filesystem::create_directories(root / "de_DE" / "LC_MESSAGES");
+      write(root / "de_DE" / "LC_MESSAGES" / (name + ".mo"), size);
+    }
+    return name;
+  }
+  const std::filesystem::path &directory() const { return root; }
+
+  // size messages in a random order, so that large catalogs don't fit into the caches.
+  static std::vector<std::string> messages(std::uint32_t size) {
+    std::vector<std::string> result;
+    result.reserve(size);
+    for (std::uint32_t i = 0; i != size; ++i)
+      result.push_back("message " + std::to_string(i));
+    std::shuffle(result.begin(), result.end(), std::mt19937(size));
+    return result;
+  }
+
+ private:
+  static void write(const std::filesystem::path &path, std::uint32_t size) {
+    std::vector<std::pair<std::string, std::string>> entries;
+    entries.emplace_back("", "Content-Type: text/plain; charset=UTF-8\n"
+                             "Plural-Forms: nplurals=2; plural=(n != 1);\n");
+    for (std::uint32_t i = 0; i != size; ++i)
+      entries.emplace_back("message " + std::to_string(i), "Nachricht " + std::to_string(i));
+    std::sort(entries.begin(), entries.end());
+
+    auto count               = static_cast<std::uint32_t>(entries.size());
+    std::uint32_t hash_size  = next_prime(std::max<std::uint32_t>(count * 4 / 3, 3));
+    std::uint32_t originals  = 28;
+    std::uint32_t translated = originals + 8 * count;
+    std::uint32_t hash_table = translated + 8 * count;
+    std::uint32_t offset     = hash_table + 4 * hash_size;
+
+    std::vector<std::uint32_t> header{0x950412de, 0,          count,     originals,
+                                      translated, hash_size, hash_table};
+    std::vector<std::uint32_t> tables(4 * count), hashes(hash_size);
+    std::string strings;
+    for (std::uint32_t i = 0; i != count; ++i) {
+      tables[2 * i]     = entries[i].first.size();
+      tables[2 * i + 1] = offset + strings.size();
+      strings.append(entries[i].first).append(1, '\0');
+    }
+    for (std::uint32_t i = 0; i != count; ++i) {
+      tables[2 * count + 2 * i]     = entries[i].second.size();
+      tables[2 * count + 2 * i + 1] = offset + strings.size();
+      strings.append(entries[i].second).append(1, '\0');
+    }
+    for (std::uint32_t i = 0; i != count; ++i) {
+      std::uint32_t hash  = mfk::i18n::hash_pjw(std::string_view(entries[i].first));
+      std::uint32_t index = hash % hash_size, inc = 1 + hash % (hash_size - 2);
+      while (hashes[index])
+        index = index >= hash_size - inc ? index - (hash_size - inc) : index + inc;
+      hashes[index] = i + 1;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    for (auto *words : {&header, &tables, &hashes})
+      file.write(reinterpret_cast<const char *>(words->data()),
+                 std::streamsize(4 * words->size()));
+    file << strings;
+  }
+
+  static std::uint32_t next_prime(std::uint32_t n) {
+    for (;; ++n) {
+      bool prime = n % 2;
+      for (std::uint32_t divisor = 3; prime && divisor * divisor <= n; divisor += 2)
+        prime = n % divisor;
+      if (prime) return n;
+    }
+  }
+
+  std::filesystem::path root;
+  std::set<std::uint32_t> written;
+};
+
+SyntheticCatalogs &synthetic_catalogs() {
+  static SyntheticCatalogs catalogs;
+  return catalogs;
+}
+
+void catalog_size_dgettext(benchmark::State &state) {
+  auto size          = static_cast<std::uint32_t>(state.range(0));
+  std::string domain = synthetic_catalogs().domain(size);
+  auto messages      = SyntheticCatalogs::messages(size);
+  bindtextdomain(domain.c_str(), synthetic_catalogs().directory().c_str());
+  if (!use_gettext(true)) return state.SkipWithError("no suitable locale installed");
+  check(state, dgettext(domain.c_str(), "message 0"), "Nachricht 0");
+  std::size_t i = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dgettext(domain.c_str(), messages[i].c_str()));
+    if (++i == messages.size()) i = 0;
+  }
+}
+BENCHMARK(catalog_size_dgettext)->RangeMultiplier(10)->Range(10, 1'000'000);
+
+void catalog_size_mo(benchmark::State &state) {
+  auto size          = static_cast<std::uint32_t>(state.range(0));
+  std::string domain = synthetic_catalogs().domain(size);
+  auto messages      = SyntheticCatalogs::messages(size);
+  Locale locale("de_DE", {{domain, synthetic_catalogs().directory()}}, domain);
+  check(state, locale.translate(domain.c_str(), "message 0"), "Nachricht 0");
+  std::size_t i = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        I18NStringCrossDomain(domain.c_str(), messages[i].c_str(), messages[i].c_str())
+            .in(locale)
+            .view()
+            .data());
+    if (++i == messages.size()) i = 0;
+  }
+}
+BENCHMARK(catalog_size_mo)->RangeMultiplier(10)->Range(10, 1'000'000);
+
+} // namespace
@@ -20,6 +20,7 @@
 #include <clang/Parse/ParseDiagnostic.h>
 #include <clang/Sema/Sema.h>
 #include <clang/Sema/SemaConsumer.h>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <llvm/ADT/APSInt.h>
@@ -378,20 +379,16 @@ class i18nVisitor : public clang::RecursiveASTVisitor<i18nVisitor> {
 
     if (end_expr && evaluates_to_nullptr(end_expr, *context)) end_expr = nullptr;
 
-    {
-      auto type = begin_expr->getType().getCanonicalType().getTypePtr();
-      if (type != str_type && type != u8str_type) {
-        auto builder = diag->Report(begin_expr->getBeginLoc(), wrong_string_type);
-        return nullopt;
-      }
+    // Wide strings are converted to UTF-8, which is the encoding of all generated files.
+    unsigned unit_size = code_unit_size(begin_expr);
+    if (!unit_size) {
+      auto builder = diag->Report(begin_expr->getBeginLoc(), wrong_string_type);
+      return nullopt;
     }
 
-    if (end_expr) {
-      auto type = end_expr->getType().getCanonicalType().getTypePtr();
-      if (type != str_type && type != u8str_type) {
-        auto builder = diag->Report(end_expr->getBeginLoc(), wrong_string_type);
-        return nullopt;
-      }
+    if (end_expr && code_unit_size(end_expr) != unit_size) {
+      auto builder = diag->Report(end_expr->getBeginLoc(), wrong_string_type);
+      return nullopt;
     }
 
     auto subscript_expr = [&] {
@@ -420,22 +417,69 @@ class i18nVisitor : public clang::RecursiveASTVisitor<i18nVisitor> {
     } else
       len = -1;
 
+    std::uint32_t high_surrogate = 0;
     llvm::APSInt index(context->getTypeSize(context->getSizeType()));
     for (; len == -1 || index < len; ++index) {
       str_index->setValue(*context, index);
       auto byte_value = subscript_expr->getIntegerConstantExpr(*context);
       if (!byte_value) { return nullopt; }
       if (len == -1 && byte_value->isNullValue()) break;
-      str.push_back(byte_value->getExtValue());
+      if (unit_size == 8) {
+        str.push_back(byte_value->getExtValue());
+        continue;
+      }
+      auto unit = static_cast<std::uint32_t>(byte_value->getZExtValue());
+      if (unit_size == 16 && unit >= 0xd800 && unit < 0xdc00) {
+        high_surrogate = unit;
+        continue;
+      }
+      if (unit_size == 16 && unit >= 0xdc00 && unit < 0xe000 && high_surrogate)
+        unit = 0x10000 + ((high_surrogate - 0xd800) << 10) + (unit - 0xdc00);
+      high_surrogate = 0;
+      append_utf8(str, unit);
     }
     return std::make_optional(str);
   }
 
  private:
+  // The size of the code units of a string, or 0 if expr does not point to characters.
+  unsigned code_unit_size(clang::Expr *expr) {
+    auto type = expr->getType().getCanonicalType().getTypePtr();
+    if (type == str_type || type == u8str_type) return 8;
+    if (type == u16str_type) return 16;
+    if (type == u32str_type) return 32;
+    if (type == wstr_type) return context->getTypeSize(context->WideCharTy);
+    return 0;
+  }
+
+  static void append_utf8(std::string &str, std::uint32_t code) {
+    if (code < 0x80) {
+      str.push_back(code);
+    } else if (code < 0x800) {
+      str.push_back(0xc0 | (code >> 6));
+      str.push_back(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+      str.push_back(0xe0 | (code >> 12));
+      str.push_back(0x80 | ((code >> 6) & 0x3f));
+      str.push_back(0x80 | (code & 0x3f));
+    } else {
+      str.push_back(0xf0 | (code >> 18));
+      str.push_back(0x80 | ((code >> 12) & 0x3f));
+      str.push_back(0x80 | ((code >> 6) & 0x3f));
+      str.push_back(0x80 | (code & 0x3f));
+    }
+  }
+
   const clang::Type *str_type =
       context->getPointerType(context->getConstType(context->CharTy)).getTypePtr();
   const clang::Type *u8str_type =
       context->getPointerType(context->getConstType(context->Char8Ty)).getTypePtr();
+  const clang::Type *u16str_type =
+      context->getPointerType(context->getConstType(context->Char16Ty)).getTypePtr();
+  const clang::Type *u32str_type =
+      context->getPointerType(context->getConstType(context->Char32Ty)).getTypePtr();
+  const clang::Type *wstr_type =
+      context->getPointerType(context->getConstType(context->WideCharTy)).getTypePtr();
   clang::IntegerLiteral *str_index =
       clang::IntegerLiteral::Create(*context, llvm::APSInt::get(0), context->getSizeType(), {});
 
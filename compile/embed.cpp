@@ -0,0 +1,260 @@
+#include "po.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <i18n/hash.hpp>
+#include <i18n/plural.hpp>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Generates a C++ translation unit which embeds the catalogs of translated .po files into a
+// program, see mfk::i18n::EmbeddedCatalog. The catalogs are stored as constant .mo images, so
+// Locale uses them exactly like files and finds messages through the hashes computed at compile
+// time.
+//
+// With --header, a single .po file is written as a header for I18N_BUILD_CATALOG instead, which
+// makes the translations part of the message literals themselves.
+
+// The hash table size used by msgfmt: the smallest prime which is at least 4/3 of the entries.
+static std::uint32_t hash_table_size(std::uint32_t count) {
+  auto is_prime = [](std::uint32_t n) {
+    for (std::uint32_t i = 2; i * i <= n; ++i)
+      if (n % i == 0) return false;
+    return true;
+  };
+  std::uint32_t size = std::max<std::uint32_t>(3, count * 4 / 3);
+  while (!is_prime(size))
+    ++size;
+  return size;
+}
+
+// Writes the entries in .mo format with native byte order.
+static std::string write_mo(PoFile po) {
+  po.entries.push_back({"", "", std::move(po.header)});
+  std::sort(po.entries.begin(), po.entries.end(),
+            [](const PoEntry &a, const PoEntry &b) { return a.key < b.key; });
+  for (std::size_t i = 1; i < po.entries.size(); ++i)
+    if (po.entries[i - 1].key == po.entries[i].key)
+      throw std::runtime_error("Duplicate message " + po.entries[i].key);
+
+  const auto count           = static_cast<std::uint32_t>(po.entries.size());
+  const std::uint32_t size   = hash_table_size(count);
+  const std::uint32_t tables = 28, hash_table = tables + 16 * count;
+  std::string mo(hash_table + 4 * size, '\0');
+  auto write = [&](std::uint32_t offset, std::uint32_t value) {
+    std::memcpy(mo.data() + offset, &value, sizeof value);
+  };
+  auto append = [&](std::string_view str) {
+    auto offset = static_cast<std::uint32_t>(mo.size());
+    mo.append(str).push_back('\0');
+    return offset;
+  };
+  write(0, 0x950412de);
+  write(8, count);
+  write(12, tables);
+  write(16, tables + 8 * count);
+  write(20, size);
+  write(24, hash_table);
+  for (std::uint32_t i = 0; i != count; ++i) {
+    const PoEntry &entry = po.entries[i];
+    std::string original = entry.key;
+    if (!entry.plural.empty()) original.append(1, '\0').append(entry.plural);
+    write(tables + 8 * i, original.size());
+    write(tables + 8 * i + 4, append(original));
+    write(tables + 8 * (count + i), entry.translation.size());
+    write(tables + 8 * (count + i) + 4, append(entry.translation));
+
+    std::uint32_t hash = mfk::i18n::hash_pjw(entry.key), slot = hash % size;
+    const std::uint32_t inc = 1 + hash % (size - 2);
+    std::uint32_t value;
+    while (std::memcpy(&value, mo.data() + hash_table + 4 * slot, sizeof value), value)
+      slot = slot >= size - inc ? slot - (size - inc) : slot + inc;
+    write(hash_table + 4 * slot, i + 1);
+  }
+  return mo;
+}
+
+// Appends c to a string literal, escaped unless it is printable.
+static void append_escaped(std::string &literal, unsigned char c) {
+  static constexpr char digits[] = "01234567";
+  if (c >= ' ' && c < 127 && c != '"' && c != '\\' && c != '?')
+    literal += c;
+  else
+    literal += {'\\', digits[c >> 6], digits[(c >> 3) & 7], digits[c & 7]};
+}
+
+static std::string literal(std::string_view str) {
+  std::string result = "\"";
+  for (char c : str)
+    append_escaped(result, c);
+  return result += '"';
+}
+
+// The value of the Language field of a .po header, or an empty string if it has none.
+static std::string language(const std::string &header) {
+  std::istringstream lines(header);
+  std::string line;
+  while (std::getline(lines, line))
+    if (line.starts_with("Language: ")) return line.substr(10);
+  return {};
+}
+
+// The plural expression of a .po header as C++ code. Only the characters of valid expressions are
+// accepted, since the header is copied into the generated code.
+static std::string plural_expression(const std::string &header) {
+  static constexpr std::string_view allowed = "n0123456789 \t()?:<>=!&|%+-*/";
+  mfk::i18n::PluralForms::from_header(header);
+  std::istringstream lines(header);
+  std::string line;
+  while (std::getline(lines, line)) {
+    auto begin = line.find("plural=");
+    if (!line.starts_with("Plural-Forms:") || begin == line.npos) continue;
+    auto expression = line.substr(begin + 7, line.find(';', begin) - begin - 7);
+    if (expression.find_first_not_of(allowed) != expression.npos)
+      throw std::runtime_error("Invalid plural expression " + expression);
+    return expression;
+  }
+  return "n != 1";
+}
+
+// Writes the translations for I18N_BUILD_CATALOG, sorted by their keys.
+static void write_header(std::ostream &out, const std::string &domain, const std::string &locale,
+                         PoFile po) {
+  std::string plural = plural_expression(po.header);
+  std::sort(po.entries.begin(), po.entries.end(),
+            [](const PoEntry &a, const PoEntry &b) { return a.key < b.key; });
+  for (std::size_t i = 1; i < po.entries.size(); ++i)
+    if (po.entries[i - 1].key == po.entries[i].key)
+      throw std::runtime_error("Duplicate message " + po.entries[i].key);
+
+  out << "// Generated by i18n-embed-catalogs, do not edit.\n"
+         "#pragma once\n\n"
+         "#include <string_view>\n\n"
+         "namespace mfk::i18n::build_catalog {\n"
+         "using namespace std::string_view_literals;\n\n"
+         "inline constexpr std::string_view domain = "
+      << literal(domain) << "sv;\ninline constexpr std::string_view locale = " << literal(locale)
+      << "sv;\ninline constexpr unsigned long nplurals = "
+      << mfk::i18n::PluralForms::from_header(po.header).nplurals()
+      << ";\n"
+         "constexpr unsigned long plural([[maybe_unused]] unsigned long n) {\n"
+         "  unsigned long form = ("
+      << plural
+      << ");\n"
+         "  return form < nplurals ? form : 0;\n"
+         "}\n\n"
+         "inline constexpr std::string_view keys[] = {\n";
+  for (auto &entry : po.entries)
+    out << "    " << literal(entry.key) << "sv,\n";
+  out << "};\n"
+         "// All forms of the translations, separated by NUL characters\n"
+         "inline constexpr std::string_view translations[] = {\n";
+  for (auto &entry : po.entries)
+    out << "    " << literal(entry.translation) << "sv,\n";
+  out << "};\n"
+         "} // namespace mfk::i18n::build_catalog\n";
+}
+
+int main(int argc, char const *argv[]) {
+  std::string domain = "messages";
+  std::string output;
+  bool header = false;
+
+  int current_arg = 1;
+  for (; argc != current_arg && *argv[current_arg] == '-'; ++current_arg) {
+    std::string_view arg = argv[current_arg];
+    if (arg == "--") {
+      ++current_arg;
+      break;
+    } else if (arg.starts_with("--domain="))
+      domain = arg.substr(9);
+    else if (arg.starts_with("--output="))
+      output = arg.substr(9);
+    else if (arg == "--header")
+      header = true;
+    else
+      std::cerr << "Ignoring unknown option " << arg << '\n';
+  }
+  if (argc == current_arg || output.empty() || (header && argc != current_arg + 1)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--domain=DOMAIN] --output=FILE.cpp [LOCALE=]FILE.po...\n"
+              << "       " << argv[0]
+              << " --header [--domain=DOMAIN] --output=FILE.hpp [LOCALE=]FILE.po\n";
+    return 1;
+  }
+
+  std::ostringstream catalogs, table;
+  std::vector<std::string> locales;
+  for (int i = current_arg; i != argc; ++i) {
+    // The locale is given as LOCALE=FILE, taken from the header or from the name of the file.
+    std::string_view argument = argv[i];
+    std::string locale;
+    if (auto separator = argument.find('='); separator < argument.find('/')) {
+      locale = argument.substr(0, separator);
+      argument.remove_prefix(separator + 1);
+    }
+    std::string filename(argument);
+    auto po = read_po_file(filename.c_str());
+    if (!po) return 1;
+    if (locale.empty()) locale = language(po->header);
+    if (locale.empty()) locale = std::filesystem::path(filename).stem().string();
+    if (std::find(locales.begin(), locales.end(), locale) != locales.end()) {
+      std::cerr << filename << ": Duplicate catalog for " << locale << '\n';
+      return 1;
+    }
+    locales.push_back(locale);
+    if (header) {
+      std::ofstream file(output, std::ios::trunc);
+      try {
+        write_header(file, domain, locale, std::move(*po));
+        if (!file.flush()) throw std::runtime_error("Unable to write " + output);
+      } catch (const std::exception &e) {
+        std::cerr << filename << ": " << e.what() << '\n';
+        std::filesystem::remove(output);
+        return 1;
+      }
+      return 0;
+    }
+    try {
+      std::string mo = write_mo(std::move(*po));
+      catalogs << "constexpr char catalog_" << i - current_arg << "[] =\n    \"";
+      // Split into literals of at most 80 characters
+      std::string line;
+      for (char c : mo) {
+        append_escaped(line, c);
+        if (line.size() < 76) continue;
+        catalogs << line << "\"\n    \"";
+        line.clear();
+      }
+      catalogs << line << "\";\n";
+    } catch (const std::exception &e) {
+      std::cerr << filename << ": " << e.what() << '\n';
+      return 1;
+    }
+    auto name = "catalog_" + std::to_string(i - current_arg);
+    table << "    {" << literal(domain) << ", " << literal(locale) << ", {" << name << ", sizeof "
+          << name << " - 1}},\n";
+  }
+
+  std::ofstream file(output, std::ios::trunc);
+  file << "// Generated by i18n-embed-catalogs, do not edit.\n"
+          "#include <i18n/embedded.hpp>\n\n"
+          "namespace {\n"
+       << catalogs.str()
+       << "\nconstexpr mfk::i18n::EmbeddedCatalog catalogs[] = {\n"
+       << table.str()
+       << "};\n"
+          "const bool registered = mfk::i18n::register_embedded_catalogs(catalogs);\n"
+          "} // namespace\n";
+  if (!file.flush()) {
+    std::cerr << "Unable to write " << output << '\n';
+    std::filesystem::remove(output);
+    return 1;
+  }
+  return 0;
+}
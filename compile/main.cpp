@@ -0,0 +1,53 @@
+#include "po.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <i18n/catalog.hpp>
+#include <iostream>
+#include <string>
+
+// Compiles a translated .po file into a catalog for mfk::i18n::CompiledCatalog.
+
+int main(int argc, char const *argv[]) {
+  std::string domain;
+  std::string output;
+
+  int current_arg = 1;
+  for (; argc != current_arg && *argv[current_arg] == '-'; ++current_arg) {
+    std::string_view arg = argv[current_arg];
+    if (arg == "--") {
+      ++current_arg;
+      break;
+    } else if (arg.starts_with("--domain="))
+      domain = arg.substr(9);
+    else if (arg.starts_with("--output="))
+      output = arg.substr(9);
+    else
+      std::cerr << "Ignoring unknown option " << arg << '\n';
+  }
+  if (argc != current_arg + 1 || output.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--domain=DOMAIN] --output=FILE FILE.po\n";
+    return 1;
+  }
+  // Catalogs are usually installed as DOMAIN.i18n
+  if (domain.empty()) domain = std::filesystem::path(output).stem().string();
+
+  auto po = read_po_file(argv[current_arg]);
+  if (!po) return 1;
+  std::vector<mfk::i18n::CompiledCatalog::Entry> entries;
+  for (auto &entry : po->entries)
+    entries.push_back({std::move(entry.key), std::move(entry.translation)});
+
+  try {
+    std::string catalog =
+        mfk::i18n::CompiledCatalog::compile(domain, po->header, std::move(entries));
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file.write(catalog.data(), catalog.size()) || !file.flush())
+      throw std::runtime_error("Unable to write " + output);
+  } catch (const std::exception &e) {
+    std::cerr << argv[current_arg] << ": " << e.what() << '\n';
+    std::filesystem::remove(output);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include "po.hpp"
+
+#include "../merge/config.hpp"
+#include "../merge/messages.hpp"
+
+#include <fstream>
+#include <iostream>
+
+// Reads a .po file without its comments, except for flags. The parser only handles the comments
+// written by i18n-extract, while translated files can contain any kind of them. The lines are
+// kept empty, so errors are reported at the right line.
+static std::string read_without_comments(const char *filename) {
+  std::ifstream file(filename);
+  if (!file) throw std::runtime_error("Unable to open file");
+  std::string str, line;
+  while (std::getline(file, line)) {
+    if (!line.starts_with('#') || line.starts_with("#, ")) str += line;
+    str += '\n';
+  }
+  return str;
+}
+
+std::optional<PoFile> read_po_file(const char *filename) {
+  std::string str;
+  try {
+    str = read_without_comments(filename);
+  } catch (const std::exception &e) {
+    std::cerr << filename << ": " << e.what() << '\n';
+    return {};
+  }
+  auto iter       = str.cbegin();
+  const auto end  = str.cend();
+  client::parser::error_handler_type error_handler(iter, end, std::cerr, filename);
+  auto parser =
+      with<boost::spirit::x3::error_handler_tag>(std::ref(error_handler))[client::message()];
+  PoFile po;
+  while (iter != end) {
+    client::ast::Message message;
+    if (!phrase_parse(iter, end, parser, boost::spirit::x3::ascii::space, message)) return {};
+    if (message.singular.empty() && !message.context) {
+      po.header = message.translation.empty() ? "" : message.translation.front();
+      continue;
+    }
+    if (message.flags && message.flags->find("fuzzy") != std::string::npos) continue;
+    std::string key =
+        message.context ? *message.context + '\4' + message.singular : message.singular;
+    std::string translation;
+    bool translated = false;
+    for (auto &form : message.translation) {
+      if (&form != &message.translation.front()) translation += '\0';
+      translation += form;
+      translated |= !form.empty();
+    }
+    if (translated)
+      po.entries.push_back(
+          {std::move(key), message.plural.value_or(std::string()), std::move(translation)});
+  }
+  return po;
+}
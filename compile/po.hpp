@@ -0,0 +1,23 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// A translated .po file as needed for compiling catalogs.
+struct PoEntry {
+  // The msgid, prefixed by its context followed by '\4' if it has one
+  std::string key;
+  // The msgid_plural, empty for entries without plural forms
+  std::string plural;
+  // All forms of the translation separated by NUL characters
+  std::string translation;
+};
+struct PoFile {
+  std::string header;
+  // Like msgfmt, fuzzy and untranslated entries are left out.
+  std::vector<PoEntry> entries;
+};
+
+// Reports errors to std::cerr and returns an empty optional if the file can not be read or parsed.
+std::optional<PoFile> read_po_file(const char *filename);
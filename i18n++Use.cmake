@@ -131,3 +131,80 @@ else()
     add_dependencies("${I18N_POT_TARGET}" "${TARGET}")
   endfunction()
 endif()
+
+# Compiles PO_FILE into OUTPUT, a catalog for mfk::i18n::CompiledCatalog. DOMAIN defaults to the
+# name of OUTPUT without its extension. OUTPUT is built by targets which depend on it.
+function(i18n_compile_catalog)
+  cmake_parse_arguments(PARSE_ARGV 0 I18N "" "PO_FILE;OUTPUT;DOMAIN" "")
+
+  if(DEFINED I18N_UNPARSED_ARGUMENTS)
+    message(WARNING "Ignoring unexpected arguments ${I18N_UNPARSED_ARGUMENTS}")
+  endif()
+
+  set(I18N_COMPILE_ARGS "--output=${I18N_OUTPUT}")
+  if(DEFINED I18N_DOMAIN)
+    list(APPEND I18N_COMPILE_ARGS "--domain=${I18N_DOMAIN}")
+  endif()
+
+  add_custom_command(OUTPUT "${I18N_OUTPUT}"
+    COMMAND $<TARGET_FILE:i18n::i18n-compile-catalog> ${I18N_COMPILE_ARGS} "${I18N_PO_FILE}"
+    DEPENDS "${I18N_PO_FILE}" $<TARGET_FILE:i18n::i18n-compile-catalog>
+    VERBATIM)
+endfunction()
+
+# Compiles the catalogs in PO_FILES into TARGET, so they are used without reading any files, see
+# mfk::i18n::EmbeddedCatalog. The locale of every catalog is taken from the Language header of the
+# file, unless it is given as LOCALE=FILE. DOMAIN defaults to messages.
+function(target_embed_catalogs TARGET)
+  cmake_parse_arguments(PARSE_ARGV 1 I18N "" "DOMAIN;OUTPUT" "PO_FILES")
+
+  if(DEFINED I18N_UNPARSED_ARGUMENTS)
+    message(WARNING "Ignoring unexpected arguments ${I18N_UNPARSED_ARGUMENTS}")
+  endif()
+
+  if(NOT DEFINED I18N_DOMAIN)
+    set(I18N_DOMAIN messages)
+  endif()
+
+  if(NOT DEFINED I18N_OUTPUT)
+    set(I18N_OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_${I18N_DOMAIN}_catalogs.cpp")
+  endif()
+
+  set(I18N_PO_DEPENDS)
+  foreach(po ${I18N_PO_FILES})
+    string(REGEX REPLACE "^[^=/]*=" "" po "${po}")
+    list(APPEND I18N_PO_DEPENDS "${po}")
+  endforeach()
+
+  add_custom_command(OUTPUT "${I18N_OUTPUT}"
+    COMMAND $<TARGET_FILE:i18n::i18n-embed-catalogs> "--domain=${I18N_DOMAIN}" "--output=${I18N_OUTPUT}" ${I18N_PO_FILES}
+    DEPENDS ${I18N_PO_DEPENDS} $<TARGET_FILE:i18n::i18n-embed-catalogs>
+    VERBATIM)
+  target_sources(${TARGET} PRIVATE "${I18N_OUTPUT}")
+endfunction()
+
+# Translates the message literals of TARGET at compile time with the translations in PO_FILE, for
+# programs which only use a single language, see I18N_BUILD_CATALOG. DOMAIN defaults to messages.
+function(target_build_catalog TARGET)
+  cmake_parse_arguments(PARSE_ARGV 1 I18N "" "PO_FILE;DOMAIN;OUTPUT" "")
+
+  if(DEFINED I18N_UNPARSED_ARGUMENTS)
+    message(WARNING "Ignoring unexpected arguments ${I18N_UNPARSED_ARGUMENTS}")
+  endif()
+
+  if(NOT DEFINED I18N_DOMAIN)
+    set(I18N_DOMAIN messages)
+  endif()
+
+  if(NOT DEFINED I18N_OUTPUT)
+    set(I18N_OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_build_catalog.hpp")
+  endif()
+
+  add_custom_command(OUTPUT "${I18N_OUTPUT}"
+    COMMAND $<TARGET_FILE:i18n::i18n-embed-catalogs> --header "--domain=${I18N_DOMAIN}" "--output=${I18N_OUTPUT}" "${I18N_PO_FILE}"
+    DEPENDS "${I18N_PO_FILE}" $<TARGET_FILE:i18n::i18n-embed-catalogs>
+    VERBATIM)
+  add_custom_target("${TARGET}_build_catalog" DEPENDS "${I18N_OUTPUT}")
+  add_dependencies("${TARGET}" "${TARGET}_build_catalog")
+  target_compile_definitions("${TARGET}" PRIVATE "I18N_BUILD_CATALOG=\"${I18N_OUTPUT}\"")
+endfunction()
@@ -1,34 +1,62 @@
 #ifndef I18N_HPP
 #define I18N_HPP
 
+#include "i18n/backend.hpp"
 #include "i18n/base.hpp"
+#include "i18n/cache.hpp"
+#include "i18n/format.hpp"
+#include "i18n/stats.hpp"
 
 #include <algorithm>
 #include <concepts>
 #include <cstdint>
+#include <iosfwd>
 #include <libintl.h>
+#include <locale>
+#include <optional>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <version>
 
-#ifndef USE_FMT
-  #if !defined(__cpp_lib_format) || __cpp_lib_format < 201907
-    #define USE_FMT 1
-  #endif
-#endif
-
-#if USE_FMT
-  #include <fmt/format.h>
-namespace fmtstd = fmt;
-#else
-  #include <format>
-namespace fmtstd = std;
+// A header generated by i18n-embed-catalogs --header from the .po file of the only language of the
+// program. Literals found in it are translated at compile time, see TranslatedI18NString.
+#ifdef I18N_BUILD_CATALOG
+  #include I18N_BUILD_CATALOG
 #endif
 
 namespace mfk::i18n {
 
+template <typename Catalog, typename Message = void>
+class LocalizedI18NString;
+template <typename Catalog, typename Message = void>
+class LocalizedI18NPluralString;
+class MessageHandle;
+class PluralMessageHandle;
+
 namespace detail {
 
+// The character type of a message type and the conversion of its UTF-8 translations, see
+// MyI18NString. Messages which are only known at runtime always use char.
+template <typename Message>
+struct message_traits {
+  using char_type = typename Message::char_type;
+  template <typename Catalog>
+  static std::basic_string_view<char_type> widen(const Catalog &catalog,
+                                                 std::string_view translated) {
+    return Message::widen(catalog, translated);
+  }
+};
+template <>
+struct message_traits<void> {
+  using char_type = char;
+  template <typename Catalog>
+  static std::string_view widen(const Catalog &, std::string_view translated) {
+    return translated;
+  }
+};
+
 // From the C++ standard:
 #if __cpp_lib_concepts < 202002L
 template<class From, class To>
@@ -39,24 +67,95 @@ concept convertible_to = std::is_convertible_v<From, To> && requires {
 using std::convertible_to;
 #endif
 
-template <typename Derived>
+// The Backend performs the actual lookups, see i18n/backend.hpp.
+template <typename Derived, typename Backend = I18N_BACKEND>
 class I18NStringImpl {
  public:
-  operator const char *() const {
-    auto &self             = *static_cast<const Derived *>(this);
-    auto &&msgid           = self.get_msgid();
-    const char *translated = dgettext(self.get_domain(), msgid);
-    return translated != msgid ? translated : self.get_singular();
-  }
-  operator std::string_view() const { return static_cast<const char *>(*this); }
+  operator const char *() const { return translate().data(); }
+  operator std::string_view() const { return translate(); }
+  // The translation with its length, which is known without scanning the string.
+  std::string_view view() const { return translate(); }
 
   template <typename... Args>
   decltype(auto) operator()(Args &&...args) const {
-    return fmtstd::vformat(std::string_view(*this),
-                           fmtstd::make_format_args(std::forward<Args>(args)...));
+    return format(nullptr, std::forward<Args>(args)...);
+  }
+  // Write into caller provided buffers instead of allocating a new string.
+  template <typename OutputIt, typename... Args>
+  OutputIt format_to(OutputIt out, const Args &...args) const {
+    return detail::format_to_in(backend(), std::move(out), translate(), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n,
+                                                   const Args &...args) const {
+    return detail::format_to_n_in(backend(), std::move(out), n, translate(), args...);
+  }
+  template <typename... Args>
+  std::size_t formatted_size(const Args &...args) const {
+    return detail::formatted_size_in(backend(), translate(), args...);
+  }
+  // Hints the backend that the message is going to be translated soon, see Batch.
+  void prefetch() const { detail::prefetch(backend(), message_info()); }
+  // The locale used for L specs in the translation.
+  const std::locale *format_locale() const { return detail::format_locale_of(backend()); }
+
+  // Translates through catalog instead of the Backend, see LocalizedI18NString.
+  template <typename Catalog>
+  LocalizedI18NString<Catalog> in(const Catalog &catalog) const {
+    auto &self = *static_cast<const Derived *>(this);
+    return LocalizedI18NString<Catalog>(catalog, self.get_domain(), self.get_msgid(),
+                                        self.get_singular(), message_info());
   }
 
  protected:
+  // info can be passed for messages known at compile time. The result is always NUL terminated.
+  std::string_view translate(const MessageInfo *info = nullptr) const {
+    auto &self   = *static_cast<const Derived *>(this);
+    if (!info) info = message_info();
+    auto &&msgid = self.get_msgid();
+    auto lookup  = [&]() -> std::string_view {
+      std::string_view translated = detail::translate(backend(), self.get_domain(), msgid, info);
+      if (translated.data() != msgid) return translated;
+      return info ? info->singular_view() : std::string_view(self.get_singular());
+    };
+    detail::StatsTimer timer;
+    std::string_view result;
+    // Catalogs with state are not known to the cache. Only registered messages have strings
+    // which live until the end of the program, so runtime strings are not cached.
+    if (std::is_empty_v<Backend> && info)
+      result = detail::cached_translation(self.get_domain(), msgid, lookup);
+    else
+      result = lookup();
+    detail::record_translation(timer, backend(), self.get_domain(), msgid, [&] {
+      return result.data() != (info ? info->singular : self.get_singular());
+    });
+    return result;
+  }
+  // Stateless backends are used through temporary objects, others are provided by Derived.
+  decltype(auto) backend() const {
+    if constexpr (std::is_empty_v<Backend>)
+      return Backend{};
+    else
+      return static_cast<const Backend &>(static_cast<const Derived *>(this)->get_backend());
+  }
+  // Derived classes which know the registry entry of their message provide get_info().
+  const MessageInfo *message_info() const {
+    if constexpr (requires(const Derived &self) { self.get_info(); })
+      return static_cast<const Derived *>(this)->get_info();
+    else
+      return nullptr;
+  }
+
+  template <typename... Args>
+  decltype(auto) format(const MessageInfo *info, Args &&...args) const {
+    return detail::format_in(backend(), translate(info), args...);
+  }
+  // The translated format string for the given arguments.
+  template <typename... Args>
+  std::string_view format_string(const MessageInfo *info, const Args &...) const {
+    return translate(info);
+  }
+
   constexpr auto get_singular() const {
     const char *msgid = static_cast<const Derived *>(this)->get_msgid();
     auto singular     = strchr(msgid, '\4');
@@ -64,23 +163,96 @@ class I18NStringImpl {
   }
 };
 
-template <typename Derived>
+template <typename Derived, typename Backend = I18N_BACKEND>
 class I18NPluralStringImpl {
  public:
-  const char *operator[](unsigned long n) const {
-    auto &self             = *static_cast<const Derived *>(this);
-    auto &&msgid           = self.get_msgid();
-    const char *translated = dngettext(self.get_domain(), msgid, self.get_plural(), n);
-    return translated != msgid ? translated : self.get_singular();
-  }
+  const char *operator[](unsigned long n) const { return translate(n).data(); }
+  // The translation for n with its length, which is known without scanning the string.
+  std::string_view view(unsigned long n) const { return translate(n); }
 
   template <convertible_to<unsigned long> First, typename... Args>
   decltype(auto) operator()(First &&first, Args &&...args) const {
-    return fmtstd::vformat((*this)[first], fmtstd::make_format_args(std::forward<First>(first),
-                                                                    std::forward<Args>(args)...));
+    return format(nullptr, std::forward<First>(first), std::forward<Args>(args)...);
+  }
+  // Write into caller provided buffers instead of allocating a new string.
+  template <typename OutputIt, convertible_to<unsigned long> First, typename... Args>
+  OutputIt format_to(OutputIt out, const First &first, const Args &...args) const {
+    return detail::format_to_in(backend(), std::move(out), translate(first), first, args...);
+  }
+  template <typename OutputIt, convertible_to<unsigned long> First, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n, const First &first,
+                                                   const Args &...args) const {
+    return detail::format_to_n_in(backend(), std::move(out), n, translate(first), first,
+                                  args...);
+  }
+  template <convertible_to<unsigned long> First, typename... Args>
+  std::size_t formatted_size(const First &first, const Args &...args) const {
+    return detail::formatted_size_in(backend(), translate(first), first, args...);
+  }
+  // Hints the backend that the message is going to be translated soon, see Batch.
+  void prefetch() const { detail::prefetch(backend(), message_info()); }
+  // The locale used for L specs in the translations.
+  const std::locale *format_locale() const { return detail::format_locale_of(backend()); }
+
+  // Translates through catalog instead of the Backend, see LocalizedI18NPluralString.
+  template <typename Catalog>
+  LocalizedI18NPluralString<Catalog> in(const Catalog &catalog) const {
+    auto &self = *static_cast<const Derived *>(this);
+    return LocalizedI18NPluralString<Catalog>(catalog, self.get_domain(), self.get_msgid(),
+                                              self.get_singular(), self.get_plural(),
+                                              message_info());
   }
 
  protected:
+  std::string_view translate(unsigned long n, const MessageInfo *info = nullptr) const {
+    auto &self   = *static_cast<const Derived *>(this);
+    if (!info) info = message_info();
+    auto &&msgid = self.get_msgid();
+    auto lookup  = [&]() -> std::string_view {
+      std::string_view translated =
+          detail::translate(backend(), self.get_domain(), msgid, self.get_plural(), n, info);
+      if (translated.data() != msgid) return translated;
+      return info ? info->singular_view() : std::string_view(self.get_singular());
+    };
+    detail::StatsTimer timer;
+    std::string_view result;
+    // Catalogs with state and runtime strings are not cached, see above.
+    if (std::is_empty_v<Backend> && info)
+      result = detail::cached_translation(self.get_domain(), msgid, n, lookup);
+    else
+      result = lookup();
+    detail::record_translation(timer, backend(), self.get_domain(), msgid, [&] {
+      return result.data() != (info ? info->singular : self.get_singular())
+             && result.data() != (info ? info->plural : self.get_plural());
+    });
+    return result;
+  }
+  // Stateless backends are used through temporary objects, others are provided by Derived.
+  decltype(auto) backend() const {
+    if constexpr (std::is_empty_v<Backend>)
+      return Backend{};
+    else
+      return static_cast<const Backend &>(static_cast<const Derived *>(this)->get_backend());
+  }
+  // Derived classes which know the registry entry of their message provide get_info().
+  const MessageInfo *message_info() const {
+    if constexpr (requires(const Derived &self) { self.get_info(); })
+      return static_cast<const Derived *>(this)->get_info();
+    else
+      return nullptr;
+  }
+
+  template <convertible_to<unsigned long> First, typename... Args>
+  decltype(auto) format(const MessageInfo *info, First &&first, Args &&...args) const {
+    return detail::format_in(backend(), translate(first, info), first, args...);
+  }
+  // The translated format string for the given arguments.
+  template <convertible_to<unsigned long> First, typename... Args>
+  std::string_view format_string(const MessageInfo *info, const First &first,
+                                 const Args &...) const {
+    return translate(first, info);
+  }
+
   constexpr auto get_singular() const {
     const char *msgid = static_cast<const Derived *>(this)->get_msgid();
     auto singular     = strchr(msgid, '\4');
@@ -113,6 +285,7 @@ class I18NStringCrossDomain :
     public detail::I18NStringImpl<I18NStringCrossDomain> {
   using I18NStringImpl = detail::I18NStringImpl<I18NStringCrossDomain>;
   friend I18NStringImpl;
+  friend MessageHandle;
 
  public:
   explicit constexpr I18NStringCrossDomain(const char *domain, const char *msgid,
@@ -120,7 +293,8 @@ class I18NStringCrossDomain :
       SmallI18NStringCrossDomain(domain, msgid),
       singular(singular) {}
   using I18NStringImpl::operator const char *, I18NStringImpl::operator std::string_view,
-      I18NStringImpl::operator();
+      I18NStringImpl::view, I18NStringImpl::operator(), I18NStringImpl::format_to,
+      I18NStringImpl::format_to_n, I18NStringImpl::formatted_size, I18NStringImpl::in;
 
  protected:
   constexpr auto get_singular() const { return singular; }
@@ -158,7 +332,8 @@ class I18NString :
     return I18NStringCrossDomain(Domain.begin(), this->msgid, singular);
   }
   using I18NStringImpl::operator const char *, I18NStringImpl::operator std::string_view,
-      I18NStringImpl::operator();
+      I18NStringImpl::view, I18NStringImpl::operator(), I18NStringImpl::format_to,
+      I18NStringImpl::format_to_n, I18NStringImpl::formatted_size, I18NStringImpl::in;
 
  protected:
   constexpr auto get_singular() const { return singular; }
@@ -186,13 +361,17 @@ class I18NPluralStringCrossDomain :
     public detail::I18NPluralStringImpl<I18NPluralStringCrossDomain> {
   using I18NPluralStringImpl = detail::I18NPluralStringImpl<I18NPluralStringCrossDomain>;
   friend I18NPluralStringImpl;
+  friend PluralMessageHandle;
 
  public:
   explicit constexpr I18NPluralStringCrossDomain(const char *domain, const char *msgid,
                                                  const char *singular, const char *plural):
       SmallI18NPluralStringCrossDomain(domain, msgid),
       singular(singular), plural(plural) {}
-  using I18NPluralStringImpl::operator[], I18NPluralStringImpl::operator();
+  using I18NPluralStringImpl::operator[], I18NPluralStringImpl::view,
+      I18NPluralStringImpl::operator(), I18NPluralStringImpl::format_to,
+      I18NPluralStringImpl::format_to_n, I18NPluralStringImpl::formatted_size,
+      I18NPluralStringImpl::in;
 
  protected:
   constexpr auto get_singular() const { return singular; }
@@ -231,7 +410,10 @@ class I18NPluralString :
   constexpr operator I18NPluralStringCrossDomain() const {
     return I18NPluralStringCrossDomain(Domain.begin(), this->msgid, singular, this->plural);
   }
-  using I18NPluralStringImpl::operator[], I18NPluralStringImpl::operator();
+  using I18NPluralStringImpl::operator[], I18NPluralStringImpl::view,
+      I18NPluralStringImpl::operator(), I18NPluralStringImpl::format_to,
+      I18NPluralStringImpl::format_to_n, I18NPluralStringImpl::formatted_size,
+      I18NPluralStringImpl::in;
 
  protected:
   constexpr auto get_singular() const { return singular; }
@@ -240,65 +422,209 @@ class I18NPluralString :
   const char *plural;
 };
 
-namespace detail {
-// The context part uses quite simple escaping rules:
-// Everything can be escaped by prepending a \ and the first
-// unescaped | limits the context part.  All unescaped
-// parens get discarded. Additionally a | counts as escaped
-// if the last previous paren was a (. Especially this implies that | enclosed
-// in parens are escaped if all parens are balanced.
-template <typename Char>
-constexpr std::tuple<const Char *, std::size_t> measure_context(const Char *const begin,
-                                                                const Char *const end) {
-  std::size_t count = 0;
-  bool grouped      = false;
-  for (auto iter = begin; end != iter; ++iter) {
-    if (*iter == '\\' && iter + 1 != end)
-      ++iter;
-    else if (*iter == '(')
-      grouped = true;
-    else if (*iter == ')')
-      grouped = false;
-    else if (*iter == '|' && !grouped)
-      return std::make_tuple(iter + 1, count);
-    ++count;
-  }
-  return std::make_tuple(begin, -1);
-}
+// A message bound to an explicit catalog, e.g. a Locale from i18n/mo.hpp, instead of the global
+// Backend. Returned by msg.in(catalog), so it can be used like the message itself:
+//
+//   msg.in(locale), msg.in(locale)[n] or msg.in(locale)(args...)
+//
+// The catalog is only referenced and has to outlive this object. For literals, Message is the type
+// of the literal, which is used to check the arguments against the untranslated strings and to
+// convert the translations to the character type of the literal.
+template <typename Catalog, typename Message>
+class LocalizedI18NString :
+    public detail::I18NStringImpl<LocalizedI18NString<Catalog, Message>, Catalog> {
+  using Impl = detail::I18NStringImpl<LocalizedI18NString, Catalog>;
+  friend Impl;
 
-// Here we take a shortcut: We don't have to track if a | is grouped, since we
-// know the length we can just check if we need more characters
-template <typename Char, std::size_t Length>
-constexpr CompileTimeString<Char, Length> extract_context(const Char *iter) {
-  if (Length == -1) return {};
-  CompileTimeString<Char, Length> result;
-  for (auto &c : result) {
-    if (*iter == '\\') ++iter;
-    c = *iter++;
+ public:
+  using char_type = typename detail::message_traits<Message>::char_type;
+
+  constexpr LocalizedI18NString(const Catalog &catalog, const char *domain, const char *msgid,
+                                const char *singular, const MessageInfo *info = nullptr):
+      catalog(&catalog),
+      domain(domain), msgid(msgid), singular(singular), info(info) {}
+
+  operator const char_type *() const { return view().data(); }
+  operator std::basic_string_view<char_type>() const { return view(); }
+  std::basic_string_view<char_type> view() const { return widen(Impl::translate(info)); }
+
+  template <typename... Args>
+  decltype(auto) operator()(Args &&...args) const {
+    check_arguments(args...);
+    return detail::format_in(*catalog, view(), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  OutputIt format_to(OutputIt out, const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to_in(*catalog, std::move(out), view(), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n,
+                                                   const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to_n_in(*catalog, std::move(out), n, view(), args...);
+  }
+  template <typename... Args>
+  std::size_t formatted_size(const Args &...args) const {
+    check_arguments(args...);
+    return detail::formatted_size_in(*catalog, view(), args...);
   }
-  *result.end() = '\0';
-  return result;
-}
 
-// The main part uses more complicated escaping since we want to allow normal
-// interpretation of parens as often as possible.
-//
-// PRECONDITION: !*end. Technically *end != 's' && *end != ')' is enough.
-template <std::size_t Singular, std::size_t Plural, typename Char>
-constexpr std::tuple<CompileTimeString<Char, Singular>, CompileTimeString<Char, Plural>>
-extract_singular_plural(const Char *iter, const Char *const end) {
-  std::tuple<CompileTimeString<Char, Singular>, CompileTimeString<Char, Plural>> result;
-  Char *out_singular = std::get<0>(result).begin(), *out_plural = std::get<1>(result).begin();
-  if (Plural == std::size_t(-1)) {
-    while (end != iter) {
-      if (*iter == '\\') ++iter;
-      *out_singular++ = *iter++;
+ protected:
+  constexpr const Catalog &get_backend() const { return *catalog; }
+  constexpr auto get_domain() const { return domain; }
+  constexpr auto get_msgid() const { return msgid; }
+  constexpr auto get_singular() const { return singular; }
+  constexpr const MessageInfo *get_info() const { return info; }
+
+  template <typename... Args>
+  static void check_arguments(const Args &...args) {
+    if constexpr (!std::is_void_v<Message>) Message::check_arguments(args...);
+  }
+  std::basic_string_view<char_type> widen(std::string_view translated) const {
+    return detail::message_traits<Message>::widen(*catalog, translated);
+  }
+
+  const Catalog *catalog;
+  const char *domain;
+  const char *msgid;
+  const char *singular;
+  const MessageInfo *info;
+};
+
+template <typename Catalog, typename Message>
+class LocalizedI18NPluralString :
+    public detail::I18NPluralStringImpl<LocalizedI18NPluralString<Catalog, Message>, Catalog> {
+  using Impl = detail::I18NPluralStringImpl<LocalizedI18NPluralString, Catalog>;
+  friend Impl;
+
+ public:
+  using char_type = typename detail::message_traits<Message>::char_type;
+
+  constexpr LocalizedI18NPluralString(const Catalog &catalog, const char *domain,
+                                      const char *msgid, const char *singular, const char *plural,
+                                      const MessageInfo *info = nullptr):
+      catalog(&catalog),
+      domain(domain), msgid(msgid), singular(singular), plural(plural), info(info) {}
+
+  const char_type *operator[](unsigned long n) const { return view(n).data(); }
+  std::basic_string_view<char_type> view(unsigned long n) const {
+    return widen(Impl::translate(n, info));
+  }
+
+  template <detail::convertible_to<unsigned long> First, typename... Args>
+  decltype(auto) operator()(First &&first, Args &&...args) const {
+    check_arguments(first, args...);
+    return detail::format_in(*catalog, view(first), first, args...);
+  }
+  template <typename OutputIt, detail::convertible_to<unsigned long> First, typename... Args>
+  OutputIt format_to(OutputIt out, const First &first, const Args &...args) const {
+    check_arguments(first, args...);
+    return detail::format_to_in(*catalog, std::move(out), view(first), first, args...);
+  }
+  template <typename OutputIt, detail::convertible_to<unsigned long> First, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n, const First &first,
+                                                   const Args &...args) const {
+    check_arguments(first, args...);
+    return detail::format_to_n_in(*catalog, std::move(out), n, view(first), first, args...);
+  }
+  template <detail::convertible_to<unsigned long> First, typename... Args>
+  std::size_t formatted_size(const First &first, const Args &...args) const {
+    check_arguments(first, args...);
+    return detail::formatted_size_in(*catalog, view(first), first, args...);
+  }
+
+ protected:
+  constexpr const Catalog &get_backend() const { return *catalog; }
+  constexpr auto get_domain() const { return domain; }
+  constexpr auto get_msgid() const { return msgid; }
+  constexpr auto get_singular() const { return singular; }
+  constexpr auto get_plural() const { return plural; }
+  constexpr const MessageInfo *get_info() const { return info; }
+
+  template <typename... Args>
+  static void check_arguments(const Args &...args) {
+    if constexpr (!std::is_void_v<Message>) Message::check_arguments(args...);
+  }
+  std::basic_string_view<char_type> widen(std::string_view translated) const {
+    return detail::message_traits<Message>::widen(*catalog, translated);
+  }
+
+  const Catalog *catalog;
+  const char *domain;
+  const char *msgid;
+  const char *singular;
+  const char *plural;
+  const MessageInfo *info;
+};
+
+namespace detail {
+// A literal split into its parts. The buffers are large enough for every literal of Length
+// characters, so the literal only has to be parsed once and the parts are copied into
+// CompileTimeStrings of the right size afterwards. A length of -1 marks a missing part.
+template <typename Char, std::size_t Length>
+struct ParsedLiteral {
+  Char context[Length + 1]    = {};
+  Char singular[Length + 1]   = {};
+  Char plural[Length + 1]     = {};
+  std::size_t context_length  = -1;
+  std::size_t singular_length = 0;
+  std::size_t plural_length   = -1;
+};
+
+template <typename Char, std::size_t Length>
+constexpr ParsedLiteral<Char, Length> parse_literal(const Char *const begin,
+                                                    const Char *const end) {
+  ParsedLiteral<Char, Length> result;
+
+  // The context part uses quite simple escaping rules:
+  // Everything can be escaped by prepending a \ and the first
+  // unescaped | limits the context part.  All unescaped
+  // parens get discarded. Additionally a | counts as escaped
+  // if the last previous paren was a (. Especially this implies that | enclosed
+  // in parens are escaped if all parens are balanced.
+  const Char *iter = begin;
+  {
+    std::size_t count = 0;
+    bool grouped      = false;
+    for (; end != iter; ++iter) {
+      if (*iter == '\\' && iter + 1 != end)
+        ++iter;
+      else if (*iter == '(')
+        grouped = true;
+      else if (*iter == ')')
+        grouped = false;
+      else if (*iter == '|' && !grouped)
+        break;
+      result.context[count++] = *iter;
+    }
+    if (end != iter) {
+      result.context_length = count;
+      ++iter;
+    } else {
+      iter = begin;
     }
-    if (out_singular != std::get<0>(result).end()) throw "Assertion failed";
   }
-  bool grouped = false;
+
+  // The main part uses more complicated escaping since we want to allow normal
+  // interpretation of parens as often as possible.
+  Char *out_singular = result.singular, *out_plural = result.plural;
+  bool grouped = false, has_plural = false;
   // The following two are only defined if grouped is true.
-  Char *try_singular, *try_plural;
+  Char *try_singular = nullptr, *try_plural = nullptr;
+  // Writes the current try to both forms as ordinary text.
+  auto revert = [&] {
+    std::copy_backward(out_singular, try_singular, try_singular + 1);
+    *out_singular = '(';
+    ++try_singular;
+    if (try_plural) {
+      *try_singular++ = '|';
+      try_singular    = std::copy(out_plural, try_plural, try_singular);
+      try_plural      = nullptr;
+    }
+    out_plural   = std::copy(out_singular, try_singular, out_plural);
+    out_singular = try_singular;
+  };
   for (; end != iter; ++iter) {
     if (grouped) {
       // If we find another '(', we treat this as a new group and assume that
@@ -307,169 +633,339 @@ extract_singular_plural(const Char *iter, const Char *const end) {
       if (try_plural && *iter == ')') {
         // The standard case. Just commit the try_... .
         grouped      = false;
+        has_plural   = true;
         out_singular = try_singular;
         out_plural   = try_plural;
       } else if (!try_plural && *iter == '|') {
         try_plural = out_plural;
       } else if (*iter == '(' || *iter == '|' || *iter == ')') {
         // We found something unexpected. Revert the current try.
-        std::copy_backward(out_singular, try_singular, try_singular + 1);
-        *out_singular = '(';
-        ++try_singular;
-        if (try_plural) {
-          *try_singular++ = '|';
-          try_singular    = std::copy(out_plural, try_plural, try_singular);
-          try_plural      = nullptr;
-        }
-        out_plural   = std::copy(out_singular, try_singular, out_plural);
-        out_singular = try_singular;
+        revert();
         if (*iter != '(') {
           grouped         = false;
           *out_singular++ = *out_plural++ = *iter;
         }
       } else {
-        if (*iter == '\\') ++iter;
+        if (*iter == '\\' && iter + 1 != end) ++iter;
         (try_plural ? *try_plural++ : *try_singular++) = *iter;
       }
     } else if (*iter == '(') {
       grouped      = true;
       try_singular = out_singular;
-      if (iter[1] == 's' && iter[2] == ')')
+      if (end - iter > 2 && iter[1] == 's' && iter[2] == ')')
         try_plural = out_plural;
       else
         try_plural = nullptr;
     } else {
-      if (*iter == '\\') ++iter;
+      if (*iter == '\\' && iter + 1 != end) ++iter;
       *out_singular++ = *out_plural++ = *iter;
     }
   }
+  // An unterminated group is ordinary text.
+  if (grouped) revert();
+
+  result.singular_length = out_singular - result.singular;
+  if (has_plural) result.plural_length = out_plural - result.plural;
   return result;
 }
 
-// Now measure the corresponding lengths.
-// Basically the same code, just reduced to counting
-template <typename Char>
-constexpr std::tuple<std::size_t, std::size_t> measure_singular_plural(const Char *iter,
-                                                                       const Char *const end) {
-  std::size_t singular = 0, plural = 0;
-  bool grouped = false, has_plural = false;
-  // The following two are only defined if grouped is true.
-  std::size_t try_singular, try_plural;
-  for (; end != iter; ++iter) {
-    if (grouped) {
-      // If we find another '(', we treat this as a new group and assume that
-      // the previous '(' should be written in both forms. Similar for a
-      // potential '|'.
-      if (try_plural != static_cast<std::size_t>(-1) && *iter == ')') {
-        // The standard case. Just commit the try_... .
-        has_plural = true;
-        grouped    = false;
-        singular += try_singular;
-        plural += try_plural;
-      } else if (try_plural == static_cast<std::size_t>(-1) && *iter == '|') {
-        try_plural = 0;
-      } else if (*iter == '(' || *iter == '|' || *iter == ')') {
-        // We found something unexpected. Revert the current try.
-        ++try_singular;
-        if (try_plural != static_cast<std::size_t>(-1)) {
-          try_singular += 1 + try_plural;
-          try_plural = -1;
-        }
-        plural += try_singular;
-        singular += try_singular;
-        if (*iter != '(') {
-          grouped = false;
-          ++singular, ++plural;
-        }
-      } else {
-        if (*iter == '\\') ++iter;
-        if (try_plural != static_cast<std::size_t>(-1))
-          ++try_plural;
-        else
-          ++try_singular;
-      }
-    } else if (*iter == '(') {
-      grouped      = true;
-      try_singular = 0;
-      if (iter[1] == 's' && iter[2] == ')')
-        try_plural = 0;
-      else
-        try_plural = -1;
-    } else
-      ++singular, ++plural;
-  }
-  return std::make_tuple(singular, has_plural ? plural : std::size_t(-1));
+// Copies the first Length characters of str.
+template <typename Char, std::size_t Length>
+constexpr CompileTimeString<Char, Length> truncate(const Char *str) {
+  CompileTimeString<Char, Length> result;
+  if constexpr (Length != std::size_t(-1)) std::copy(str, str + Length, result.begin());
+  return result;
 }
 
+// For other character types than char, the inherited members work with the UTF-8 strings, which
+// are used for the lookups. The members declared here return strings of the literal's character
+// type, which are transcoded from the UTF-8 translations once and then cached.
 template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
           CompileTimeString Plural>
 struct MyI18NString :
     private CompileTimeI18NString<Domain, Context, Singular, Plural>,
-    public std::conditional_t<!!Plural, I18NPluralString<Domain>, I18NString<Domain>> {
+    public std::conditional_t<!!Plural, I18NPluralString<utf8_string<Domain>>,
+                              I18NString<utf8_string<Domain>>> {
  private:
-  using CTS = typename MyI18NString::CompileTimeI18NString;
+  using CTS  = typename MyI18NString::CompileTimeI18NString;
+  using Impl =
+      std::conditional_t<!!Plural, I18NPluralStringImpl<I18NPluralString<utf8_string<Domain>>>,
+                         I18NStringImpl<I18NString<utf8_string<Domain>>>>;
 
  public:
+  using char_type = typename CTS::char_type;
+
+  // The registry entry of the message, which describes the UTF-8 strings, see MessageHandle.
+  static constexpr const MessageInfo &info() { return CTS::info(); }
+  static constexpr bool has_plural = !!Plural;
+
+  // Referencing info() registers the message, even if it is never translated through this type.
   constexpr MyI18NString() requires(!!Plural):
-      MyI18NString::I18NPluralString(CTS::msgid(), CTS::singular(), CTS::plural()) {}
+      MyI18NString::I18NPluralString(CTS::utf8_msgid(), CTS::utf8_singular(),
+                                     CTS::utf8_plural()) {
+    static_cast<void>(CTS::info());
+  }
   constexpr MyI18NString() requires(!Plural):
-      MyI18NString::I18NString(CTS::msgid(), CTS::singular()) {}
+      MyI18NString::I18NString(CTS::utf8_msgid(), CTS::utf8_singular()) {
+    static_cast<void>(CTS::info());
+  }
+
+  // Same as the inherited members, but they pass the precomputed message info to the backend.
+  operator const char_type *() const requires(!Plural) { return view().data(); }
+  operator std::basic_string_view<char_type>() const requires(!Plural) { return view(); }
+  std::basic_string_view<char_type> view() const requires(!Plural) {
+    return widen(Impl::backend(), Impl::translate(&CTS::info()));
+  }
+  const char_type *operator[](unsigned long n) const requires(!!Plural) { return view(n).data(); }
+  std::basic_string_view<char_type> view(unsigned long n) const requires(!!Plural) {
+    return widen(Impl::backend(), Impl::translate(n, &CTS::info()));
+  }
+
   template <typename... Args>
   decltype(auto) operator()(Args &&...args) const {
+    check_arguments(std::forward<Args>(args)...);
+    return detail::format_in(Impl::backend(), format_view(args...), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  OutputIt format_to(OutputIt out, const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to_in(Impl::backend(), std::move(out), format_view(args...), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n,
+                                                   const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to_n_in(Impl::backend(), std::move(out), n, format_view(args...),
+                                  args...);
+  }
+  template <typename... Args>
+  std::size_t formatted_size(const Args &...args) const {
+    check_arguments(args...);
+    return detail::formatted_size_in(Impl::backend(), format_view(args...), args...);
+  }
+  void prefetch() const { detail::prefetch(Impl::backend(), &CTS::info()); }
+
+  template <typename Catalog>
+  auto in(const Catalog &catalog) const {
+    if constexpr (!!Plural)
+      return LocalizedI18NPluralString<Catalog, MyI18NString>(
+          catalog, CTS::utf8_domain(), CTS::utf8_msgid(), CTS::utf8_singular(),
+          CTS::utf8_plural(), &CTS::info());
+    else
+      return LocalizedI18NString<Catalog, MyI18NString>(catalog, CTS::utf8_domain(),
+                                                        CTS::utf8_msgid(), CTS::utf8_singular(),
+                                                        &CTS::info());
+  }
+
+  // Checks the arguments against the untranslated strings at compile time. Only char and wchar_t
+  // messages can be formatted.
+  template <typename... Args>
+  static void check_arguments(Args &&...args) {
+    static_assert(std::is_same_v<char_type, char> || std::is_same_v<char_type, wchar_t>,
+                  "Messages can only be formatted for char and wchar_t");
     if (false) {
       (void)fmtstd::format(Singular.str, std::forward<Args>(args)...);
       if constexpr (Plural) (void)fmtstd::format(Plural.str, std::forward<Args>(args)...);
     }
-    if constexpr (Plural)
-      return MyI18NString::I18NPluralString::operator()(std::forward<Args>(args)...);
+  }
+
+  // The translated format string for args, converted to char_type.
+  template <typename... Args>
+  std::basic_string_view<char_type> format_view(const Args &...args) const {
+    return widen(Impl::backend(), Impl::format_string(&CTS::info(), args...));
+  }
+  // Converts a translation returned by catalog to char_type. Untranslated messages use the
+  // original strings, translations are transcoded once per catalog, see transcoded_in.
+  template <typename Catalog>
+  static std::basic_string_view<char_type> widen(const Catalog &catalog,
+                                                 std::string_view translated) {
+    if constexpr (std::is_same_v<char_type, char>) {
+      return translated;
+    } else {
+      if (translated.data() == CTS::utf8_singular()) return {CTS::singular(), Singular.length};
+      if constexpr (!!Plural)
+        if (translated.data() == CTS::utf8_plural()) return {CTS::plural(), Plural.length};
+      return transcoded_in<char_type>(catalog, translated);
+    }
+  }
+};
+#ifdef I18N_BUILD_CATALOG
+// The index of the translation of a message in the build catalog, or std::size_t(-1) if it isn't
+// translated there. Messages without domain belong to the domain of the build catalog.
+constexpr std::size_t build_translation(const char *domain, std::string_view key) {
+  if (domain && build_catalog::domain != domain) return -1;
+  auto begin = std::begin(build_catalog::keys), end = std::end(build_catalog::keys);
+  auto iter  = std::lower_bound(begin, end, key);
+  return iter != end && *iter == key ? iter - begin : -1;
+}
+
+constexpr std::size_t build_form_count(std::size_t index) {
+  std::string_view forms = build_catalog::translations[index];
+  return std::count(forms.begin(), forms.end(), '\0') + 1;
+}
+
+// Form of the translation at Index in the build catalog, transcoded to Char.
+template <typename Char, std::size_t Index, std::size_t Form>
+inline constexpr auto build_form = [] {
+  constexpr std::string_view form = [] {
+    std::string_view forms = build_catalog::translations[Index];
+    for (std::size_t i = 0; i != Form; ++i)
+      forms.remove_prefix(forms.find('\0') + 1);
+    return forms.substr(0, forms.find('\0'));
+  }();
+  constexpr const char *end = form.data() + form.size();
+  CompileTimeString<Char, transcoded_length<Char>(form.data(), end)> result;
+  *transcode(form.data(), end, result.begin()) = Char();
+  return result;
+}();
+
+// The system locale for the language of the build catalog, which is used for L format specs.
+inline const std::locale *build_locale() {
+  static const std::optional<std::locale> locale = std_locale_for(build_catalog::locale);
+  return locale ? &*locale : nullptr;
+}
+
+// A message whose translation was substituted at compile time from I18N_BUILD_CATALOG. Forms
+// contains the translated forms in the order of the catalog, so translating only selects a form
+// and the arguments are checked against the translations. Translations through in(catalog) are
+// still looked up at runtime.
+template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
+          CompileTimeString Plural, CompileTimeString... Forms>
+struct TranslatedI18NString : MyI18NString<Domain, Context, Singular, Plural> {
+  using typename TranslatedI18NString::MyI18NString::char_type;
+
+  operator const char_type *() const requires(!Plural) { return view().data(); }
+  operator std::basic_string_view<char_type>() const requires(!Plural) { return view(); }
+  constexpr std::basic_string_view<char_type> view() const requires(!Plural) { return form(0); }
+  const char_type *operator[](unsigned long n) const requires(!!Plural) { return view(n).data(); }
+  constexpr std::basic_string_view<char_type> view(unsigned long n) const requires(!!Plural) {
+    return form(build_catalog::plural(n));
+  }
+
+  template <typename... Args>
+  decltype(auto) operator()(Args &&...args) const {
+    check_arguments(std::forward<Args>(args)...);
+    return detail::format(build_locale(), format_string(args...), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  OutputIt format_to(OutputIt out, const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to(build_locale(), std::move(out), format_string(args...), args...);
+  }
+  template <typename OutputIt, typename... Args>
+  fmtstd::format_to_n_result<OutputIt> format_to_n(OutputIt out, std::size_t n,
+                                                   const Args &...args) const {
+    check_arguments(args...);
+    return detail::format_to_n(build_locale(), std::move(out), n, format_string(args...),
+                               args...);
+  }
+  template <typename... Args>
+  std::size_t formatted_size(const Args &...args) const {
+    check_arguments(args...);
+    return detail::formatted_size(build_locale(), format_string(args...), args...);
+  }
+  // Nothing is looked up at runtime.
+  void prefetch() const {}
+  static const std::locale *format_locale() { return build_locale(); }
+
+  // Checks the arguments against all translated forms at compile time.
+  template <typename... Args>
+  static void check_arguments(Args &&...args) {
+    static_assert(std::is_same_v<char_type, char> || std::is_same_v<char_type, wchar_t>,
+                  "Messages can only be formatted for char and wchar_t");
+    if (false) ((void)fmtstd::format(Forms.str, std::forward<Args>(args)...), ...);
+  }
+
+ private:
+  // Missing forms fall back to the first one, as in libintl.
+  static constexpr std::basic_string_view<char_type> form(std::size_t index) {
+    constexpr std::basic_string_view<char_type> forms[] = {{begin_of<Forms>, Forms.length}...};
+    return forms[index < sizeof...(Forms) ? index : 0];
+  }
+  template <typename... Args>
+  static constexpr std::basic_string_view<char_type> format_string(const Args &...args) {
+    if constexpr (!!Plural)
+      return form(build_catalog::plural(std::get<0>(std::tie(args...))));
     else
-      return MyI18NString::I18NString::operator()(std::forward<Args>(args)...);
+      return form(0);
   }
 };
+
+// The message type for a literal: TranslatedI18NString if the build catalog translates it,
+// otherwise MyI18NString.
+template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
+          CompileTimeString Plural>
+constexpr auto build_message() {
+  using Message               = MyI18NString<Domain, Context, Singular, Plural>;
+  using char_type             = typename Message::char_type;
+  constexpr std::size_t index = build_translation(Message::info().domain, Message::info().key());
+  if constexpr (index == std::size_t(-1))
+    return Message();
+  else
+    return []<std::size_t... I>(std::index_sequence<I...>) {
+      return TranslatedI18NString<Domain, Context, Singular, Plural,
+                                  build_form<char_type, index, I>...>();
+    }(std::make_index_sequence<build_form_count(index)>());
+}
+template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
+          CompileTimeString Plural>
+using BuildI18NString = decltype(build_message<Domain, Context, Singular, Plural>());
+#endif
+} // namespace detail
+
+namespace detail {
+template <typename Derived, typename Backend>
+void as_message(const I18NStringImpl<Derived, Backend> &);
+
+// Messages of this library without plural forms, whose view() returns a std::string_view. Other
+// types with a view() member, e.g. std::ostringstream, are left alone.
+template <typename Message>
+concept viewable = requires(const Message &message) {
+  detail::as_message(message);
+  { message.view() } -> std::same_as<std::string_view>;
+};
 } // namespace detail
 
+// Messages without plural forms can be written to streams and used as formatting arguments
+// directly. Both use view(), so the translation does not have to be measured again.
+template <typename Traits, detail::viewable Message>
+std::basic_ostream<char, Traits> &operator<<(std::basic_ostream<char, Traits> &stream,
+                                             const Message &message) {
+  return stream << message.view();
+}
+
 template <template <CompileTimeString, CompileTimeString, CompileTimeString, CompileTimeString>
           typename I18NStringBase,
           CompileTimeString Str,
           CompileTimeString Domain =
               CompileTimeString<typename decltype(Str)::char_type, std::size_t(-1)>()>
 constexpr auto build_I18NString_generic() {
-  using char_type = typename decltype(Str)::char_type;
-  // We are working in two steps:
-  constexpr auto lengths = [] {
-    struct {
-      std::size_t context = -1, singular = 0, plural = -1;
-      const char_type *start_main;
-    } result;
-    std::tie(result.start_main, result.context) = detail::measure_context(Str.begin(), Str.end());
-    std::tie(result.singular, result.plural) =
-        detail::measure_singular_plural(result.start_main, Str.end());
-    return result;
-  }();
-
-  struct TripleString {
-    CompileTimeString<char_type, lengths.context> context;
-    CompileTimeString<char_type, lengths.singular> singular;
-    CompileTimeString<char_type, lengths.plural> plural;
-  };
-  constexpr TripleString strings = [&] {
-    TripleString result{};
-    result.context = detail::extract_context<char_type, lengths.context>(Str.begin());
-    std::tie(result.singular, result.plural) =
-        detail::extract_singular_plural<lengths.singular, lengths.plural>(lengths.start_main,
-                                                                          Str.end());
-    return result;
-  }();
-
-  return I18NStringBase<Domain, strings.context, strings.singular, strings.plural>();
+  using char_type        = typename decltype(Str)::char_type;
+  constexpr auto parsed  = detail::parse_literal<char_type, Str.length>(Str.begin(), Str.end());
+  constexpr auto context = detail::truncate<char_type, parsed.context_length>(parsed.context);
+  constexpr auto singular =
+      detail::truncate<char_type, parsed.singular_length>(parsed.singular);
+  constexpr auto plural = detail::truncate<char_type, parsed.plural_length>(parsed.plural);
+  return I18NStringBase<Domain, context, singular, plural>();
 }
 
 template <CompileTimeString Str, CompileTimeString Domain = CompileTimeString<
                                      typename decltype(Str)::char_type, std::size_t(-1)>()>
 constexpr auto build_I18NString() {
+#ifdef I18N_BUILD_CATALOG
+  return build_I18NString_generic<detail::BuildI18NString, Str, Domain>();
+#else
   return build_I18NString_generic<detail::MyI18NString, Str, Domain>();
+#endif
 }
 
 } // namespace mfk::i18n
 
+template <mfk::i18n::detail::viewable Message>
+struct fmtstd::formatter<Message, char> : fmtstd::formatter<std::string_view, char> {
+  auto format(const Message &message, auto &context) const {
+    return fmtstd::formatter<std::string_view, char>::format(message.view(), context);
+  }
+};
+
 #endif
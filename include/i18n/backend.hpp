@@ -0,0 +1,105 @@
+#ifndef I18N_BACKEND_HPP
+#define I18N_BACKEND_HPP
+
+#include "hash.hpp"
+#include "registry.hpp"
+
+#include <libintl.h>
+#include <string_view>
+
+// A backend provides the actual lookup of translations for the string classes. It has to provide
+//
+//   static const char *translate(const char *domain, const char *msgid);
+//   static const char *translate(const char *domain, const char *msgid, const char *plural,
+//                                unsigned long n);
+//
+// with the same semantics as dgettext and dngettext: If no translation is found, msgid (or plural
+// if n != 1) has to be returned unchanged. A domain of nullptr refers to the current default
+// domain.
+//
+// Backends can additionally provide overloads taking a trailing `const MessageHash &`, or
+//
+//   static const char *translate(const MessageInfo &info);
+//   static const char *translate(const MessageInfo &info, unsigned long n);
+//
+// These are used for literals, whose hashes are known at compile time and which have an index in
+// the message registry.
+//
+// Instead of const char *, translate can return a NUL terminated std::string_view. Backends which
+// know the lengths of their translations should do so, since the string classes otherwise have to
+// measure every translation with strlen.
+//
+// Backends which resolve registered messages into tables can also provide
+//
+//   static void prefetch(const MessageInfo &info);
+//
+// which loads the memory read by translate(info) into the CPU cache, e.g. while a Batch is
+// translating many messages.
+//
+// Objects with non-static translate members, like mfk::i18n::Locale, can be passed explicitly
+// through msg.in(catalog).
+//
+// The backend used by all string classes can be selected by defining I18N_BACKEND, e.g. to
+// mfk::i18n::MoBackend from i18n/mo.hpp. The header declaring the backend has to be included in
+// every translation unit which translates strings.
+#ifndef I18N_BACKEND
+  #define I18N_BACKEND ::mfk::i18n::GettextBackend
+#endif
+
+namespace mfk::i18n {
+
+// Forwards all lookups to libintl.
+struct GettextBackend {
+  static const char *translate(const char *domain, const char *msgid) {
+    return dgettext(domain, msgid);
+  }
+  static const char *translate(const char *domain, const char *msgid, const char *plural,
+                               unsigned long n) {
+    return dngettext(domain, msgid, plural, n);
+  }
+};
+
+class MoBackend;
+
+namespace detail {
+// Backends can also be objects, e.g. a Locale from i18n/mo.hpp.
+template <typename Backend>
+std::string_view translate(const Backend &backend, const char *domain, const char *msgid,
+                           const MessageInfo *info) {
+  if (info) {
+    if constexpr (requires { backend.translate(*info); })
+      return backend.translate(*info);
+    else if constexpr (requires { backend.translate(domain, msgid, info->hash); })
+      return backend.translate(domain, msgid, info->hash);
+  }
+  return backend.translate(domain, msgid);
+}
+template <typename Backend>
+std::string_view translate(const Backend &backend, const char *domain, const char *msgid,
+                           const char *plural, unsigned long n, const MessageInfo *info) {
+  if (info) {
+    if constexpr (requires { backend.translate(*info, n); })
+      return backend.translate(*info, n);
+    else if constexpr (requires { backend.translate(domain, msgid, plural, n, info->hash); })
+      return backend.translate(domain, msgid, plural, n, info->hash);
+  }
+  return backend.translate(domain, msgid, plural, n);
+}
+
+// Hints that info is going to be translated through backend soon. Does nothing for backends
+// without prefetch and for messages which aren't registered.
+template <typename Backend>
+void prefetch(const Backend &backend, const MessageInfo *info) {
+  if constexpr (requires { backend.prefetch(*info); })
+    if (info) backend.prefetch(*info);
+}
+inline void prefetch_address([[maybe_unused]] const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#endif
+}
+} // namespace detail
+
+} // namespace mfk::i18n
+
+#endif
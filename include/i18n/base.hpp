@@ -1,10 +1,15 @@
 #ifndef I18N_BASE_HPP
 #define I18N_BASE_HPP
 
+#include "hash.hpp"
+#include "registry.hpp"
+#include "transcode.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <concepts>
 #include <cstdint>
+#include <string_view>
 
 #ifdef __has_cpp_attribute
 #if __has_cpp_attribute(mfk::i18n)
@@ -18,7 +23,7 @@
 
 namespace mfk::i18n {
 
-// Char should be char, char8_t, char16_t or char32_t.
+// Char should be char, char8_t, char16_t, char32_t or wchar_t.
 template <typename Char, std::size_t Length>
 struct CompileTimeString {
   constexpr CompileTimeString() = default;
@@ -92,6 +97,36 @@ join_with_separator(CompileTimeString<Char1, std::size_t(-1)>, Char2,
   return str2;
 }
 
+// The UTF-8 version of Str, which is Str itself for narrow strings.
+template <CompileTimeString Str>
+inline constexpr auto utf8_string = [] {
+  using char_type = typename decltype(Str)::char_type;
+  if constexpr (std::is_same_v<char_type, char>) {
+    return Str;
+  } else if constexpr (Str.length == std::size_t(-1)) {
+    return CompileTimeString<char, std::size_t(-1)>();
+  } else {
+    constexpr std::size_t length = transcoded_length<char>(Str.begin(), Str.end());
+    CompileTimeString<char, length> result;
+    *transcode(Str.begin(), Str.end(), result.begin()) = '\0';
+    return result;
+  }
+}();
+
+// The length of utf8_string<Str>, without instantiating it.
+template <typename Char, std::size_t Length>
+constexpr std::size_t utf8_length(const CompileTimeString<Char, Length> &str) {
+  if constexpr (Length == std::size_t(-1))
+    return -1;
+  else
+    return transcoded_length<char>(str.begin(), str.end());
+}
+
+// The address of the template parameter object for Str, which is the same in all templates taking
+// Str as argument.
+template <CompileTimeString Str>
+inline constexpr auto begin_of = Str.begin();
+
 } // namespace detail
 
 template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
@@ -109,10 +144,49 @@ class I18N_ATTR() CompileTimeI18NString {
   static constexpr auto msgid() { return idStorage.begin(); }
   static constexpr auto singular() { return singular_begin; }
   static constexpr auto plural() { return plural_begin; }
+  // The strings as used for lookups. Catalogs are always UTF-8, so for other character types these
+  // are transcoded copies.
+  static constexpr const char *utf8_domain() {
+    return detail::begin_of<detail::utf8_string<Domain>>;
+  }
+  static constexpr const char *utf8_msgid() { return messageInfo.msgid; }
+  static constexpr const char *utf8_singular() { return messageInfo.singular; }
+  static constexpr const char *utf8_plural() { return messageInfo.plural; }
+  // Hashes of the UTF-8 lookup key, i.e. of utf8_msgid() without the plural part.
+  static constexpr const MessageHash &hash() { return keyHash; }
+  // The registry entry of this message. Using it ensures that the message gets registered during
+  // static initialization.
+  static constexpr const auto &info() { return messageInfo; }
+  // Whether the message has a plural form, e.g. to constrain templates on it.
+  static constexpr bool has_plural = Plural.length != -1;
 
  private:
   static constexpr auto idStorage = detail::join_with_separator(
       detail::join_with_separator(Context, char_type('\4'), Singular), char_type('\0'), Plural);
+  static constexpr bool utf8 = std::is_same_v<char_type, char>;
+  // Only instantiated for other character types, since this is done for every literal.
+  static constexpr auto utf8Storage = [] {
+    if constexpr (utf8)
+      return nullptr;
+    else
+      return detail::join_with_separator(
+          detail::join_with_separator(detail::utf8_string<Context>, '\4',
+                                      detail::utf8_string<Singular>),
+          '\0', detail::utf8_string<Plural>);
+  }();
+  static constexpr const char *utf8Begin = [] {
+    if constexpr (utf8)
+      return idStorage.begin();
+    else
+      return utf8Storage.begin();
+  }();
+  static constexpr std::size_t utf8ContextLength = detail::utf8_length(Context);
+  static constexpr std::size_t utf8SingularLength = detail::utf8_length(Singular);
+  static constexpr std::size_t utf8PluralLength   = detail::utf8_length(Plural);
+  static constexpr std::size_t keyLength = utf8ContextLength == -1
+                                               ? utf8SingularLength
+                                               : utf8ContextLength + 1 + utf8SingularLength;
+  static constexpr MessageHash keyHash = hash_message(std::string_view(utf8Begin, keyLength));
   static constexpr auto domain_begin I18N_ATTR(_domain_begin) =
       Domain.length == -1 ? nullptr : Domain.begin();
   static constexpr auto domain_end I18N_ATTR(_domain_end) =
@@ -129,8 +203,27 @@ class I18N_ATTR() CompileTimeI18NString {
       Plural.length == -1 ? nullptr : singular_end + 1;
   static constexpr const char_type *plural_end I18N_ATTR(_plural_end) =
       plural_begin ? plural_begin + Plural.length : nullptr;
+
+  // Written by the registry, possibly before the initializer below runs, see registered_index.
+  static std::uint32_t registration;
+  // Describes the UTF-8 strings, which are the same as the ones above for narrow strings.
+  static constexpr MessageInfo messageInfo{
+      detail::begin_of<detail::utf8_string<Domain>>,
+      utf8Begin,
+      utf8Begin + (utf8ContextLength + 1),
+      Plural.length == -1 ? nullptr : utf8Begin + keyLength + 1,
+      keyLength,
+      utf8SingularLength,
+      Plural.length == -1 ? 0 : utf8PluralLength,
+      keyHash,
+      &registration};
 };
 
+template <CompileTimeString Domain, CompileTimeString Context, CompileTimeString Singular,
+          CompileTimeString Plural>
+std::uint32_t CompileTimeI18NString<Domain, Context, Singular, Plural>::registration =
+    detail::register_message(&CompileTimeI18NString::messageInfo);
+
 } // namespace mfk::i18n
 
 #endif
@@ -0,0 +1,203 @@
+#ifndef I18N_BATCH_HPP
+#define I18N_BATCH_HPP
+
+#include "../i18n.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mfk::i18n {
+
+namespace detail {
+// A message queued in a Batch together with copies of its arguments.
+class QueuedMessage {
+ public:
+  virtual ~QueuedMessage() = default;
+  virtual void prefetch() const = 0;
+  // The translated format string
+  virtual std::string_view lookup() const = 0;
+  virtual void format(std::string &buffer, std::string_view format) const = 0;
+};
+
+template <typename Message, typename... Args>
+class QueuedMessageOf final : public QueuedMessage {
+ public:
+  explicit QueuedMessageOf(const Message &message, const Args &...args):
+      message(message), args(args...) {}
+
+  void prefetch() const override {
+    if constexpr (requires { message.prefetch(); }) message.prefetch();
+  }
+  std::string_view lookup() const override {
+    return std::apply([&](const auto &...args) { return format_string(args...); }, args);
+  }
+  void format(std::string &buffer, std::string_view format) const override {
+    const std::locale *locale = nullptr;
+    if constexpr (requires { message.format_locale(); }) locale = message.format_locale();
+    std::apply(
+        [&](const auto &...args) {
+          detail::format_to(locale, std::back_inserter(buffer), format, args...);
+        },
+        args);
+  }
+
+ private:
+  // Plural messages select their form by the first argument.
+  std::string_view format_string() const { return message.view(); }
+  template <typename First, typename... Rest>
+  std::string_view format_string(const First &first, const Rest &...) const {
+    if constexpr (requires { message.view(first); })
+      return message.view(first);
+    else
+      return message.view();
+  }
+
+  Message message;
+  std::tuple<Args...> args;
+};
+} // namespace detail
+
+// Translates and formats many messages into a single contiguous buffer, e.g. while rendering a
+// page. Messages are queued with add() and resolved together: resolve() first looks up all their
+// translations in one pass, prefetching the entries of the following messages for backends which
+// support it (see i18n/backend.hpp), and then formats them one after another. Message i occupies
+// text()[offsets()[i], offsets()[i + 1]).
+//
+// Clearing a batch keeps its memory, so a batch which is reused does not allocate once it has
+// grown large enough. Messages can be bound to an explicit catalog before adding them, e.g.
+// batch.add(msg.in(locale)), and the catalog has to outlive the call to resolve().
+class Batch {
+ public:
+  Batch() = default;
+  Batch(Batch &&other) noexcept { *this = std::move(other); }
+  Batch &operator=(Batch &&other) noexcept {
+    discard();
+    buffer  = std::move(other.buffer);
+    ends    = std::exchange(other.ends, {0});
+    queued  = std::move(other.queued);
+    formats = std::move(other.formats);
+    blocks  = std::move(other.blocks);
+    current = std::exchange(other.current, 0);
+    used    = std::exchange(other.used, 0);
+    other.queued.clear();
+    return *this;
+  }
+  ~Batch() { discard(); }
+
+  // Queues the message for formatting with args and returns its index. Plural messages take the
+  // number selecting the plural form as first argument, as for operator(). The message and the
+  // arguments are copied, but like for std::format, the data of pointers and views they contain
+  // has to stay valid until resolve().
+  template <typename Message, typename... Args>
+  std::size_t add(const Message &message, const Args &...args) {
+    // Checks the arguments at compile time like the other members of the message.
+    if (false) static_cast<void>(message.formatted_size(args...));
+    using Queued = detail::QueuedMessageOf<Message, std::decay_t<const Args>...>;
+    static_assert(alignof(Queued) <= alignof(std::max_align_t));
+    queued.push_back(new (allocate(sizeof(Queued), alignof(Queued))) Queued(message, args...));
+    return size() - 1;
+  }
+  // Translates and formats all queued messages. If this throws, e.g. because a translation is not
+  // a valid format string, all queued messages are discarded and the resolved ones are kept.
+  void resolve() {
+    const std::size_t resolved = size() - queued.size(), length = buffer.size();
+    try {
+      formats.resize(queued.size());
+      for (std::size_t i = 0; i != std::min(prefetch_distance, queued.size()); ++i)
+        queued[i]->prefetch();
+      for (std::size_t i = 0; i != queued.size(); ++i) {
+        if (i + prefetch_distance < queued.size()) queued[i + prefetch_distance]->prefetch();
+        formats[i] = queued[i]->lookup();
+      }
+      for (std::size_t i = 0; i != queued.size(); ++i) {
+        queued[i]->format(buffer, formats[i]);
+        ends.push_back(buffer.size());
+      }
+    } catch (...) {
+      ends.resize(resolved + 1);
+      buffer.resize(length);
+      discard();
+      throw;
+    }
+    discard();
+  }
+
+  // Reserves memory for messages with a total length of bytes.
+  void reserve(std::size_t messages, std::size_t bytes) {
+    ends.reserve(messages + 1);
+    queued.reserve(messages);
+    formats.reserve(messages);
+    buffer.reserve(bytes);
+  }
+  void clear() {
+    discard();
+    ends.resize(1);
+    buffer.clear();
+  }
+
+  // Number of messages, including the queued ones.
+  std::size_t size() const { return ends.size() - 1 + queued.size(); }
+  bool empty() const { return !size(); }
+  // Only resolved messages can be accessed.
+  std::string_view operator[](std::size_t index) const {
+    assert(index + 1 < ends.size());
+    return std::string_view(buffer).substr(ends[index], ends[index + 1] - ends[index]);
+  }
+
+  // All resolved messages concatenated.
+  std::string_view text() const { return buffer; }
+  // The start of every resolved message followed by the end of the last one.
+  std::span<const std::size_t> offsets() const { return ends; }
+
+ private:
+  // How many messages ahead of the current lookup are prefetched
+  static constexpr std::size_t prefetch_distance = 4;
+  static constexpr std::size_t block_size        = 4096;
+
+  // Queued messages are stored in blocks which are kept until the batch is destroyed.
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+  void *allocate(std::size_t size, std::size_t alignment) {
+    for (; current != blocks.size(); ++current, used = 0) {
+      std::size_t offset = (used + alignment - 1) / alignment * alignment;
+      if (offset + size <= blocks[current].size) {
+        used = offset + size;
+        return blocks[current].data.get() + offset;
+      }
+    }
+    std::size_t allocated = std::max(size, block_size);
+    blocks.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[allocated]), allocated});
+    used = size;
+    return blocks.back().data.get();
+  }
+  void discard() {
+    for (detail::QueuedMessage *message : queued)
+      message->~QueuedMessage();
+    queued.clear();
+    current = used = 0;
+  }
+
+  std::string buffer;
+  std::vector<std::size_t> ends{0};
+  std::vector<detail::QueuedMessage *> queued;
+  std::vector<std::string_view> formats;
+  std::vector<Block> blocks;
+  std::size_t current = 0, used = 0;
+};
+
+} // namespace mfk::i18n
+
+#endif
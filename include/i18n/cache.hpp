@@ -0,0 +1,145 @@
+#ifndef I18N_CACHE_HPP
+#define I18N_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <libintl.h>
+#include <locale>
+#include <string_view>
+#include <utility>
+
+#ifndef I18N_CACHE_TRANSLATIONS
+  #define I18N_CACHE_TRANSLATIONS 0
+#endif
+
+// Number of entries in the per-thread translation cache. Has to be a power of two.
+#ifndef I18N_CACHE_SIZE
+  #define I18N_CACHE_SIZE 512
+#endif
+
+#ifdef __GLIBC__
+// glibc increments this whenever setlocale, textdomain or bindtextdomain is called. It is the same
+// counter libintl uses internally to invalidate its own caches.
+extern "C" int _nl_msg_cat_cntr;
+#endif
+
+namespace mfk::i18n {
+
+namespace detail {
+inline std::atomic<unsigned> generation_counter{0};
+// Changes which only affect the current thread, e.g. installing a thread specific locale.
+inline thread_local unsigned thread_generation = 0;
+
+inline void invalidate_thread_translations() { ++thread_generation; }
+} // namespace detail
+
+// Returns a value which changes whenever previously returned translations might have become stale.
+inline unsigned catalog_generation() {
+  unsigned generation = detail::generation_counter.load(std::memory_order_acquire)
+                        + detail::thread_generation;
+#ifdef __GLIBC__
+  generation += static_cast<unsigned>(_nl_msg_cat_cntr);
+#endif
+  return generation;
+}
+
+// Has to be called after changes which can not be detected automatically, e.g. after modifying the
+// LANGUAGE environment variable.
+inline void invalidate_translations() {
+  detail::generation_counter.fetch_add(1, std::memory_order_acq_rel);
+}
+
+// Wrappers around the libintl and standard library functions which additionally invalidate all
+// cached translations.
+inline const char *textdomain(const char *domainname) {
+  const char *result = ::textdomain(domainname);
+  if (domainname) invalidate_translations();
+  return result;
+}
+inline const char *bindtextdomain(const char *domainname, const char *dirname) {
+  const char *result = ::bindtextdomain(domainname, dirname);
+  if (dirname) invalidate_translations();
+  return result;
+}
+inline std::locale set_locale(const std::locale &locale) {
+  std::locale previous = std::locale::global(locale);
+  invalidate_translations();
+  return previous;
+}
+
+namespace detail {
+// A direct mapped cache of translations. Keys are the addresses of the domain and the msgid, so
+// this must only be used for strings with static storage duration, which is the case for the
+// strings of all registered messages (literals and interned MessageHandles), see MessageInfo.
+class TranslationCache {
+ public:
+  static constexpr std::size_t size = I18N_CACHE_SIZE;
+  static_assert(size && !(size & (size - 1)), "I18N_CACHE_SIZE has to be a power of two");
+
+  template <typename Lookup>
+  std::string_view get(const char *domain, const char *msgid, Lookup &&lookup) {
+    return get(domain, msgid, false, 0, std::forward<Lookup>(lookup));
+  }
+  template <typename Lookup>
+  std::string_view get(const char *domain, const char *msgid, unsigned long n, Lookup &&lookup) {
+    return get(domain, msgid, true, n, std::forward<Lookup>(lookup));
+  }
+
+ private:
+  struct Entry {
+    const char *domain;
+    const char *msgid;
+    unsigned long n;
+    std::string_view translation;
+    unsigned generation;
+    bool plural;
+  };
+
+  template <typename Lookup>
+  std::string_view get(const char *domain, const char *msgid, bool plural, unsigned long n,
+                       Lookup &&lookup) {
+    const unsigned generation = catalog_generation();
+    auto key                  = reinterpret_cast<std::uintptr_t>(msgid) >> 3;
+    key ^= reinterpret_cast<std::uintptr_t>(domain) >> 3;
+    key ^= n * 0x9e3779b9u;
+    Entry &entry = entries[key & (size - 1)];
+    if (entry.translation.data() && entry.generation == generation && entry.msgid == msgid
+        && entry.domain == domain && entry.plural == plural && entry.n == n)
+      return entry.translation;
+    std::string_view translation = std::forward<Lookup>(lookup)();
+    entry = Entry{domain, msgid, n, translation, generation, plural};
+    return translation;
+  }
+
+  Entry entries[size] = {};
+};
+
+inline thread_local TranslationCache translation_cache;
+
+template <typename Lookup>
+inline std::string_view cached_translation(const char *domain, const char *msgid,
+                                           Lookup &&lookup) {
+#if I18N_CACHE_TRANSLATIONS
+  return translation_cache.get(domain, msgid, std::forward<Lookup>(lookup));
+#else
+  (void)domain, (void)msgid;
+  return std::forward<Lookup>(lookup)();
+#endif
+}
+
+template <typename Lookup>
+inline std::string_view cached_translation(const char *domain, const char *msgid, unsigned long n,
+                                           Lookup &&lookup) {
+#if I18N_CACHE_TRANSLATIONS
+  return translation_cache.get(domain, msgid, n, std::forward<Lookup>(lookup));
+#else
+  (void)domain, (void)msgid, (void)n;
+  return std::forward<Lookup>(lookup)();
+#endif
+}
+
+} // namespace detail
+} // namespace mfk::i18n
+
+#endif
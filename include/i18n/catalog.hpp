@@ -0,0 +1,549 @@
+#ifndef I18N_CATALOG_HPP
+#define I18N_CATALOG_HPP
+
+#include "format.hpp"
+#include "hash.hpp"
+#include "plural.hpp"
+#include "transcode.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <locale>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define I18N_HAS_MMAP 1
+#else
+  #include <fstream>
+  #define I18N_HAS_MMAP 0
+#endif
+
+namespace mfk::i18n {
+
+namespace detail {
+
+// Literal text followed by a replacement field of a format string stored in a CompiledCatalog.
+// Offsets are relative to the start of the string.
+struct FormatSegment {
+  std::uint32_t literal, literal_length;
+  // -1 if the segment only consists of text
+  std::int32_t arg;
+  std::uint32_t spec, spec_length;
+};
+
+// Splits format into segments like ParsedFormat, or returns std::nullopt if it is not a valid
+// format string or uses named arguments or nested replacement fields, which are left to the
+// formatting library.
+inline std::optional<std::vector<FormatSegment>> split_format(std::string_view format) {
+  std::vector<FormatSegment> segments;
+  bool automatic = false, manual = false;
+  std::int32_t next   = 0;
+  std::size_t literal = 0, i = 0;
+  auto segment = [&](std::size_t end) {
+    return FormatSegment{std::uint32_t(literal), std::uint32_t(end - literal), -1, 0, 0};
+  };
+  while (i != format.size()) {
+    if (format[i] != '{' && format[i] != '}') {
+      ++i;
+      continue;
+    }
+    // Escaped braces end the current literal after the first of them
+    if (i + 1 != format.size() && format[i + 1] == format[i]) {
+      segments.push_back(segment(i + 1));
+      literal = i += 2;
+      continue;
+    }
+    if (format[i] == '}') return std::nullopt;
+
+    FormatSegment field = segment(i);
+    if (++i != format.size() && format[i] >= '0' && format[i] <= '9') {
+      if (automatic) return std::nullopt;
+      manual = true;
+      for (field.arg = 0; i != format.size() && format[i] >= '0' && format[i] <= '9'; ++i)
+        if ((field.arg = field.arg * 10 + (format[i] - '0')) > 0xffff) return std::nullopt;
+    } else {
+      if (manual) return std::nullopt;
+      automatic = true;
+      field.arg = next++;
+    }
+    if (i == format.size() || (format[i] != ':' && format[i] != '}')) return std::nullopt;
+    if (format[i] == ':') ++i;
+    auto end = format.find_first_of("{}", i);
+    if (end == format.npos || format[end] != '}') return std::nullopt;
+    field.spec        = std::uint32_t(i);
+    field.spec_length = std::uint32_t(end - i);
+    segments.push_back(field);
+    literal = i = end + 1;
+  }
+  segments.push_back(segment(format.size()));
+  return segments;
+}
+
+} // namespace detail
+
+// A read-only view of a catalog in the format written by i18n-compile-catalog, which is designed
+// for the lookups of this library instead of libintl's:
+//
+// - Keys are found through a minimal perfect hash of the MessageHash::fast hashes, which are
+//   computed at compile time for literals, so a lookup is one probe and one string comparison.
+// - Strings are stored with their length in front and 8 byte aligned, so translations are
+//   returned as NUL terminated std::string_views without scanning them.
+// - Translated format strings are stored split into literals and replacement fields, so
+//   msg.in(catalog)(args...) does not parse them again.
+// - The Plural-Forms expression is stored as verified bytecode instead of being parsed on load.
+//
+// A catalog contains the translations of one domain for one language. Like MoFile, the file is
+// mapped into memory, so loading is cheap and lookups don't allocate.
+class CompiledCatalog {
+ public:
+  // An empty catalog, all messages stay untranslated.
+  CompiledCatalog() = default;
+  // Throws std::system_error if the file can not be read and std::runtime_error if it is not a
+  // valid catalog.
+  explicit CompiledCatalog(const std::filesystem::path &path) {
+    map(path);
+    try {
+      validate();
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+  CompiledCatalog(const CompiledCatalog &)            = delete;
+  CompiledCatalog &operator=(const CompiledCatalog &) = delete;
+  ~CompiledCatalog() { unmap(); }
+
+  // An entry to compile, with the same representation as in .mo files.
+  struct Entry {
+    // "msgctxt\4msgid" or just "msgid"
+    std::string key;
+    // All plural forms separated by NUL characters
+    std::string translation;
+  };
+  // Compiles a catalog for domain. header is the translation of the empty msgid, which is not
+  // part of entries. Throws std::invalid_argument if the Plural-Forms header is malformed and
+  // std::runtime_error if the keys can not be hashed, e.g. because they contain duplicates.
+  static std::string compile(std::string_view domain, std::string_view header,
+                             std::vector<Entry> entries);
+
+  // Number of entries, without the header entry.
+  std::uint32_t size() const { return count; }
+  std::string_view domain() const { return data ? string(read(28)) : ""; }
+  std::string_view header() const { return data ? string(read(32)) : ""; }
+  const PluralForms &plural_forms() const { return plural_forms_; }
+  // The locale of the Language header, used for L format specs. nullptr if it is not installed,
+  // then the global locale is used.
+  const std::locale *format_locale() const {
+    return format_locale_ ? &*format_locale_ : nullptr;
+  }
+  // translation, which was returned by this catalog, converted to Char, see Locale::transcoded.
+  template <typename Char>
+  std::basic_string_view<Char> transcoded(std::string_view translation) const {
+    return transcoded_.get<Char>(translation);
+  }
+
+  // Lookups with the semantics of dgettext and dngettext, see i18n/backend.hpp. Other domains
+  // than the catalog's are not translated. The results are NUL terminated.
+  std::string_view translate(const char *domain, const char *msgid) const {
+    std::string_view key = msgid;
+    return translate(domain, key, hash_fast(key));
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n) const {
+    std::string_view key = msgid;
+    return translate(domain, key, plural, n, hash_fast(key));
+  }
+  // Literals use the hashes computed at compile time.
+  std::string_view translate(const char *domain, const char *msgid,
+                             const MessageHash &hash) const {
+    return translate(domain, msgid, hash.fast);
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n, const MessageHash &hash) const {
+    return translate(domain, msgid, plural, n, hash.fast);
+  }
+
+#if USE_FMT
+  // Formats a translation returned by this catalog with its pre-parsed segments. Other strings, and
+  // translations with fields depending on the catalog's locale, are formatted by fmt directly.
+  void vformat_to(fmt::memory_buffer &buffer, std::string_view format,
+                  fmt::format_args args) const {
+    std::uint32_t table = segments(format);
+    const std::locale *locale = format_locale();
+    if (!table || (locale && uses_locale(table, format, args))) {
+      if (locale)
+        fmt::vformat_to(fmt::appender(buffer), *locale, format, args);
+      else
+        fmt::vformat_to(fmt::appender(buffer), format, args);
+      return;
+    }
+    fmt::format_context context(fmt::appender(buffer), args);
+    for (std::uint32_t i = 0, count = read(table); i != count; ++i) {
+      std::uint32_t segment = table + 4 + i * segment_size;
+      auto literal          = format.substr(read(segment), read(segment + 4));
+      buffer.append(literal.data(), literal.data() + literal.size());
+      auto arg = static_cast<std::int32_t>(read(segment + 8));
+      if (arg >= 0)
+        detail::format_arg(context, format.substr(read(segment + 12), read(segment + 16)),
+                           args.get(arg));
+    }
+  }
+#endif
+
+ private:
+#if USE_FMT
+  // Whether a field of the segment table of format depends on the locale, see uses_locale.
+  bool uses_locale(std::uint32_t table, std::string_view format, fmt::format_args args) const {
+    for (std::uint32_t i = 0, count = read(table); i != count; ++i) {
+      std::uint32_t segment = table + 4 + i * segment_size;
+      auto arg              = static_cast<std::int32_t>(read(segment + 8));
+      if (arg >= 0
+          && detail::uses_locale(format.substr(read(segment + 12), read(segment + 16)),
+                                 args.get(arg)))
+        return true;
+    }
+    return false;
+  }
+#endif
+
+  // All numbers are little-endian. The header consists of the magic number, the revision, the
+  // size of the file, the number of entries, the number of buckets of the perfect hash and the
+  // offsets of the displacements of the buckets, the slots, the domain, the header and the plural
+  // bytecode, followed by two reserved words.
+  //
+  // A key with hash h belongs to bucket (h >> 32) * buckets >> 32 and is stored in slot
+  // mix(h + d * 0x9e3779b97f4a7c15) * count >> 64 of the count slots, where d is the displacement
+  // of its bucket. Every slot consists of the 64 bit hash, the offset of the key, the number of
+  // plural forms and either the offset of the translation, or of a table with the offsets of all
+  // forms, and a reserved word.
+  //
+  // Strings are 8 byte aligned and consist of their length, the offset of their segment table or
+  // 0, their bytes and a NUL character. Segment tables consist of the number of segments followed
+  // by the detail::FormatSegments.
+  static constexpr std::uint32_t magic        = 0x43383149;
+  static constexpr std::uint32_t header_size  = 48;
+  static constexpr std::uint32_t slot_size    = 24;
+  static constexpr std::uint32_t segment_size = 20;
+
+  static std::uint64_t mix(std::uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdu;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53u;
+    return hash ^ (hash >> 33);
+  }
+  static std::uint32_t bucket(std::uint64_t hash, std::uint32_t buckets) {
+    return static_cast<std::uint32_t>(((hash >> 32) * buckets) >> 32);
+  }
+  static std::uint32_t slot(std::uint64_t hash, std::uint32_t displacement, std::uint32_t count) {
+    auto mixed = mix(hash + displacement * 0x9e3779b97f4a7c15u);
+    return static_cast<std::uint32_t>(((mixed >> 32) * count) >> 32);
+  }
+
+  template <typename T = std::uint32_t>
+  T read(std::uint32_t offset) const {
+    T value;
+    std::memcpy(&value, data + offset, sizeof value);
+    if constexpr (std::endian::native == std::endian::big) value = byteswap(value);
+    return value;
+  }
+  template <typename T>
+  static T byteswap(T value) {
+    T result = 0;
+    for (std::size_t i = 0; i != sizeof value; ++i, value >>= 8)
+      result = (result << 8) | (value & 0xff);
+    return result;
+  }
+  std::string_view string(std::uint32_t offset) const { return {data + offset + 8, read(offset)}; }
+
+  // Returns the offset of the slot of key, or 0 if the catalog does not contain it.
+  std::uint32_t find(std::string_view key, std::uint64_t hash) const {
+    if (!count) return 0;
+    std::uint32_t displacement = read(displacements + 4 * bucket(hash, buckets));
+    std::uint32_t offset       = slots + slot_size * slot(hash, displacement, count);
+    if (read<std::uint64_t>(offset) != hash || string(read(offset + 8)) != key) return 0;
+    return offset;
+  }
+  std::string_view form(std::uint32_t slot, unsigned long index) const {
+    std::uint32_t forms = read(slot + 12), offset = read(slot + 16);
+    if (forms == 1) return string(offset);
+    // Missing forms fall back to the first one, as in libintl.
+    return string(read(offset + 4 * (index < forms ? index : 0)));
+  }
+  bool matches(const char *domain) const { return !domain || this->domain() == domain; }
+
+  std::string_view translate(const char *domain, std::string_view key, std::uint64_t hash) const {
+    if (matches(domain))
+      if (std::uint32_t slot = find(key, hash)) return form(slot, 0);
+    return key;
+  }
+  std::string_view translate(const char *domain, std::string_view key, const char *plural,
+                             unsigned long n, std::uint64_t hash) const {
+    if (matches(domain))
+      if (std::uint32_t slot = find(key, hash)) return form(slot, plural_forms_(n));
+    return n == 1 ? key : plural;
+  }
+
+  // The segment table of format if it is a string of this catalog, or 0.
+  std::uint32_t segments(std::string_view format) const {
+    auto address = reinterpret_cast<std::uintptr_t>(format.data());
+    auto begin   = reinterpret_cast<std::uintptr_t>(data);
+    if (!data || address < begin + header_size + 8 || address >= begin + size_) return 0;
+    auto offset = static_cast<std::uint32_t>(address - begin - 8);
+    if (offset % 8 || read(offset) != format.size()) return 0;
+    // Views into the middle of a string could look like a string, but not with a valid table.
+    std::uint64_t table = read(offset + 4);
+    if (!table || table % 4 || table + 4 > size_
+        || table + 4 + std::uint64_t(read(table)) * segment_size > size_)
+      return 0;
+    return table;
+  }
+
+  // Checks all tables and strings once, so that lookups can trust them.
+  void validate() {
+    auto invalid = [] { throw std::runtime_error("Invalid compiled catalog"); };
+    auto fits    = [&](std::uint64_t offset, std::uint64_t entries, std::uint64_t entry_size) {
+      return offset % 4 == 0 && offset + entries * entry_size <= size_;
+    };
+    // Checks the string at offset and its segment table.
+    auto check_string = [&](std::uint32_t offset) {
+      if (offset % 8 || !fits(offset, 1, 8)) invalid();
+      std::uint64_t length = read(offset), end = std::uint64_t(offset) + 8 + length;
+      if (end >= size_ || data[end]) invalid();
+      if (std::uint32_t table = read(offset + 4)) {
+        if (!fits(table, 1, 4) || !fits(table + 4, read(table), segment_size)) invalid();
+        for (std::uint32_t i = 0; i != read(table); ++i) {
+          std::uint32_t segment = table + 4 + i * segment_size;
+          auto arg              = static_cast<std::int32_t>(read(segment + 8));
+          if (std::uint64_t(read(segment)) + read(segment + 4) > length
+              || std::uint64_t(read(segment + 12)) + read(segment + 16) > length || arg < -1)
+            invalid();
+        }
+      }
+    };
+    if (size_ < header_size || read(0) != magic || read(4) >> 16 || read(8) != size_) invalid();
+    count         = read(12);
+    buckets       = read(16);
+    displacements = read(20);
+    slots         = read(24);
+    if (!fits(displacements, buckets, 4) || slots % 8 || !fits(slots, count, slot_size)
+        || (count && !buckets))
+      invalid();
+    for (std::uint32_t offset : {read(28), read(32), read(36)})
+      check_string(offset);
+    for (std::uint32_t i = 0; i != count; ++i) {
+      std::uint32_t slot = slots + i * slot_size;
+      check_string(read(slot + 8));
+      std::uint32_t forms = read(slot + 12), offset = read(slot + 16);
+      if (forms == 1) {
+        check_string(offset);
+        continue;
+      }
+      if (!forms || !fits(offset, forms, 4)) invalid();
+      for (std::uint32_t form = 0; form != forms; ++form)
+        check_string(read(offset + 4 * form));
+    }
+    try {
+      plural_forms_ = PluralForms::from_bytecode(string(read(36)));
+    } catch (const std::invalid_argument &) {
+      invalid();
+    }
+    for (auto header = this->header(); !header.empty();) {
+      auto line = header.substr(0, header.find('\n'));
+      header.remove_prefix(std::min(header.size(), line.size() + 1));
+      if (line.starts_with("Language: ")) format_locale_ = detail::std_locale_for(line.substr(10));
+    }
+  }
+
+#if I18N_HAS_MMAP
+  void map(const std::filesystem::path &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path.string());
+    struct stat info {};
+    void *mapping = MAP_FAILED;
+    if (!::fstat(fd, &info) && info.st_size && info.st_size <= 0xffffffff)
+      mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      if (!info.st_size || info.st_size > 0xffffffff)
+        throw std::runtime_error("Invalid compiled catalog");
+      throw std::system_error(error, std::generic_category(), path.string());
+    }
+    data  = static_cast<const char *>(mapping);
+    size_ = info.st_size;
+  }
+  void unmap() {
+    if (data) ::munmap(const_cast<char *>(data), size_);
+  }
+#else
+  void map(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::system_error(errno, std::generic_category(), path.string());
+    size_       = std::filesystem::file_size(path);
+    char *owned = new char[size_];
+    if (!file.read(owned, size_)) {
+      delete[] owned;
+      throw std::runtime_error("Unable to read compiled catalog");
+    }
+    data = owned;
+  }
+  void unmap() { delete[] data; }
+#endif
+
+  const char *data  = nullptr;
+  std::size_t size_ = 0;
+  std::uint32_t count = 0, buckets, displacements, slots;
+  PluralForms plural_forms_;
+  std::optional<std::locale> format_locale_;
+  detail::TranscodedStrings transcoded_;
+};
+
+inline std::string CompiledCatalog::compile(std::string_view domain, std::string_view header,
+                                            std::vector<Entry> entries) {
+  auto plural_forms = PluralForms::from_header(header);
+  if (entries.size() >= 0xffffffff) throw std::length_error("Catalog is too large");
+  auto count = static_cast<std::uint32_t>(entries.size());
+
+  // Keys with equal hashes can never be separated.
+  std::vector<std::uint64_t> hashes;
+  for (auto &entry : entries)
+    hashes.push_back(hash_fast(entry.key));
+  std::vector<std::uint32_t> by_hash(count);
+  for (std::uint32_t i = 0; i != count; ++i)
+    by_hash[i] = i;
+  std::sort(by_hash.begin(), by_hash.end(), [&](auto a, auto b) { return hashes[a] < hashes[b]; });
+  for (std::uint32_t i = 1; i < count; ++i)
+    if (auto &a = entries[by_hash[i - 1]].key, &b = entries[by_hash[i]].key;
+        hashes[by_hash[i - 1]] == hashes[by_hash[i]])
+      throw std::runtime_error(a == b ? "Duplicate key in catalog: " + a
+                                      : "Colliding hashes of keys " + a + " and " + b);
+
+  // Buckets of about three keys are placed largest first, trying displacements until all keys of
+  // a bucket land in distinct free slots.
+  std::uint32_t buckets = count / 3 + 1;
+  std::vector<std::vector<std::uint32_t>> members(buckets);
+  for (std::uint32_t i = 0; i != count; ++i)
+    members[bucket(hashes[i], buckets)].push_back(i);
+  std::vector<std::uint32_t> order(buckets);
+  for (std::uint32_t i = 0; i != buckets; ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return members[a].size() > members[b].size();
+  });
+  std::vector<std::uint32_t> displacement(buckets), entry_of(count, std::uint32_t(-1));
+  std::vector<std::uint32_t> placed;
+  for (auto index : order) {
+    auto &keys = members[index];
+    if (keys.empty()) break;
+    for (std::uint32_t d = 0;; ++d) {
+      if (d == 0xffffffff) throw std::runtime_error("Unable to hash the catalog's keys");
+      placed.clear();
+      for (auto key : keys) {
+        auto target = slot(hashes[key], d, count);
+        if (entry_of[target] != std::uint32_t(-1)) break;
+        entry_of[target] = key;
+        placed.push_back(target);
+      }
+      if (placed.size() == keys.size()) {
+        displacement[index] = d;
+        break;
+      }
+      for (auto target : placed)
+        entry_of[target] = std::uint32_t(-1);
+    }
+  }
+
+  std::string image(header_size, '\0');
+  auto put = [&](std::uint64_t offset, std::uint64_t value, std::size_t bytes = 4) {
+    if (bytes == 4 && value > 0xffffffff) throw std::length_error("Catalog is too large");
+    for (std::size_t i = 0; i != bytes; ++i)
+      image[offset + i] = static_cast<char>(value >> 8 * i);
+  };
+  auto align = [&](std::size_t alignment) {
+    image.resize((image.size() + alignment - 1) / alignment * alignment, '\0');
+    return image.size();
+  };
+  // Appends a string with its segment table, if it is a format string with replacement fields or
+  // escaped braces.
+  auto add_string = [&](std::string_view str) {
+    std::size_t table = 0;
+    if (auto segments = detail::split_format(str); segments && segments->size() > 1) {
+      table = align(4);
+      image.resize(table + 4 + segment_size * segments->size());
+      put(table, segments->size());
+      for (std::size_t i = 0; i != segments->size(); ++i) {
+        auto &segment      = (*segments)[i];
+        std::size_t offset = table + 4 + segment_size * i;
+        put(offset, segment.literal);
+        put(offset + 4, segment.literal_length);
+        put(offset + 8, std::uint32_t(segment.arg));
+        put(offset + 12, segment.spec);
+        put(offset + 16, segment.spec_length);
+      }
+    }
+    std::size_t offset = align(8);
+    image.resize(offset + 8);
+    put(offset, str.size());
+    put(offset + 4, table);
+    image.append(str).append(1, '\0');
+    return offset;
+  };
+
+  put(0, magic);
+  put(12, count);
+  put(16, buckets);
+  put(20, image.size());
+  for (auto d : displacement) {
+    image.resize(image.size() + 4);
+    put(image.size() - 4, d);
+  }
+  std::size_t slots = align(8);
+  put(24, slots);
+  image.resize(slots + slot_size * count);
+  put(28, add_string(domain));
+  put(32, add_string(header));
+  put(36, add_string(plural_forms.bytecode()));
+  for (std::uint32_t i = 0; i != count; ++i) {
+    auto &entry        = entries[entry_of[i]];
+    std::size_t offset = slots + slot_size * i;
+    put(offset, hashes[entry_of[i]], 8);
+    put(offset + 8, add_string(entry.key));
+    std::vector<std::size_t> forms;
+    for (std::string_view rest = entry.translation;;) {
+      auto end = std::min(rest.find('\0'), rest.size());
+      forms.push_back(add_string(rest.substr(0, end)));
+      if (end == rest.size()) break;
+      rest.remove_prefix(end + 1);
+    }
+    put(offset + 12, forms.size());
+    if (forms.size() == 1) {
+      put(offset + 16, forms[0]);
+      continue;
+    }
+    std::size_t table = align(4);
+    put(offset + 16, table);
+    image.resize(table + 4 * forms.size());
+    for (std::size_t form = 0; form != forms.size(); ++form)
+      put(table + 4 * form, forms[form]);
+  }
+  put(8, align(8));
+  return image;
+}
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef I18N_EMBEDDED_HPP
+#define I18N_EMBEDDED_HPP
+
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace mfk::i18n {
+
+// A catalog in .mo format which is compiled into the program. Translation units with embedded
+// catalogs are generated by i18n-embed-catalogs (see target_embed_catalogs in i18n++Use.cmake) and
+// register their catalogs during static initialization. MoBackend and Locale use them for all
+// domains which are not bound to a directory, instead of reading any files.
+struct EmbeddedCatalog {
+  const char *domain;
+  // The locale name, e.g. "de" or "de_AT"
+  const char *locale;
+  std::string_view image;
+};
+
+namespace detail {
+class EmbeddedCatalogs {
+ public:
+  void add(std::span<const EmbeddedCatalog> catalogs) {
+    std::lock_guard lock(mutex);
+    for (auto &catalog : catalogs)
+      entries.push_back(&catalog);
+  }
+  // Returns nullptr if no catalog for locale and domain was embedded.
+  const EmbeddedCatalog *find(std::string_view domain, std::string_view locale) const {
+    std::lock_guard lock(mutex);
+    for (auto *catalog : entries)
+      if (catalog->domain == domain && catalog->locale == locale) return catalog;
+    return nullptr;
+  }
+  bool contains(std::string_view domain) const {
+    std::lock_guard lock(mutex);
+    for (auto *catalog : entries)
+      if (catalog->domain == domain) return true;
+    return false;
+  }
+  std::vector<const EmbeddedCatalog *> snapshot() const {
+    std::lock_guard lock(mutex);
+    return entries;
+  }
+
+ private:
+  mutable std::mutex mutex;
+  std::vector<const EmbeddedCatalog *> entries;
+};
+
+inline EmbeddedCatalogs &embedded_catalog_registry() {
+  static EmbeddedCatalogs registry;
+  return registry;
+}
+} // namespace detail
+
+// Called by the generated translation units. catalogs has to stay alive until the program ends.
+inline bool register_embedded_catalogs(std::span<const EmbeddedCatalog> catalogs) {
+  detail::embedded_catalog_registry().add(catalogs);
+  return true;
+}
+
+// All catalogs compiled into the program, e.g. to list the languages it can be switched to.
+inline std::vector<const EmbeddedCatalog *> embedded_catalogs() {
+  return detail::embedded_catalog_registry().snapshot();
+}
+
+} // namespace mfk::i18n
+
+#endif
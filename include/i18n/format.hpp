@@ -0,0 +1,447 @@
+#ifndef I18N_FORMAT_HPP
+#define I18N_FORMAT_HPP
+
+#include "cache.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+#include <iterator>
+#include <locale>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <version>
+
+#ifndef USE_FMT
+  #if !defined(__cpp_lib_format) || __cpp_lib_format < 201907
+    #define USE_FMT 1
+  #endif
+#endif
+
+#if USE_FMT
+  #include <fmt/format.h>
+  #include <fmt/xchar.h>
+namespace fmtstd = fmt;
+#else
+  #include <format>
+namespace fmtstd = std;
+#endif
+
+#ifndef I18N_CACHE_FORMATS
+  #define I18N_CACHE_FORMATS 0
+#endif
+
+// Number of entries in the per-thread cache of parsed format strings. Has to be a power of two.
+#ifndef I18N_FORMAT_CACHE_SIZE
+  #define I18N_FORMAT_CACHE_SIZE 128
+#endif
+
+namespace mfk::i18n {
+namespace detail {
+
+// The system locale for the first of languages which is installed, where languages is a colon
+// separated list as used by the LANGUAGE environment variable. The UTF-8 variant of a locale is
+// preferred if no codeset is given. Returns an empty optional if none of them is installed.
+inline std::optional<std::locale> std_locale_for(std::string_view languages) {
+  while (!languages.empty()) {
+    auto language = languages.substr(0, languages.find(':'));
+    languages.remove_prefix(std::min(languages.size(), language.size() + 1));
+    if (language.empty() || language == "C" || language == "POSIX") continue;
+    std::string names[2];
+    if (language.find('.') == language.npos) {
+      auto modifier = std::min(language.find('@'), language.size());
+      names[0]      = std::string(language.substr(0, modifier)) + ".UTF-8";
+      names[0] += language.substr(modifier);
+    }
+    names[1] = language;
+    for (auto &name : names)
+      try {
+        if (!name.empty()) return std::locale(name);
+      } catch (const std::runtime_error &) {
+      }
+  }
+  return {};
+}
+
+#if USE_FMT
+// Formats arg with spec, which must not contain nested replacement fields, as if it was the
+// replacement field "{:spec}".
+inline void format_arg(fmt::format_context &context, std::string_view spec,
+                       fmt::basic_format_arg<fmt::format_context> arg) {
+  using Handle = fmt::basic_format_arg<fmt::format_context>::handle;
+  fmt::visit_format_arg(
+      [&](auto value) {
+        using T = decltype(value);
+        fmt::format_parse_context parse(spec);
+        if constexpr (std::is_same_v<T, fmt::monostate>) {
+          throw fmt::format_error("argument not found");
+        } else if constexpr (std::is_same_v<T, Handle>) {
+          value.format(parse, context);
+        } else {
+          fmt::formatter<T> formatter;
+          formatter.parse(parse);
+          context.advance_to(formatter.format(value, context));
+        }
+      },
+      arg);
+}
+
+// Whether formatting arg with spec can depend on the locale, i.e. spec has the L option or arg has
+// a custom formatter, which may use the locale in any way. Contexts with an explicit locale can
+// only be created by fmt itself, so such fields have to be formatted through fmt's functions taking
+// a std::locale.
+inline bool uses_locale(std::string_view spec, fmt::basic_format_arg<fmt::format_context> arg) {
+  using Handle = fmt::basic_format_arg<fmt::format_context>::handle;
+  if (spec.find('L') != spec.npos) return true;
+  return fmt::visit_format_arg(
+      [](auto value) { return std::is_same_v<decltype(value), Handle>; }, arg);
+}
+
+// A format string split into literal text and replacement fields. The specs of all fields are
+// parsed in advance for the argument types the string was first used with, so formatting only has
+// to substitute the arguments. Arguments of other types get their specs parsed on every use.
+class ParsedFormat {
+ public:
+  // Returns false if the string uses features which are not handled here, e.g. named arguments or
+  // automatically numbered fields nested in specs, whose numbers continue those of the string and
+  // would be lost when a spec is parsed again for other argument types. Such strings have to be
+  // formatted by fmt directly.
+  bool parse(std::string_view format, fmt::format_args args) {
+    segments.clear();
+    fmt::format_parse_context context(format);
+    const char *iter = format.data(), *const end = iter + format.size();
+    const char *literal = iter;
+    while (iter != end) {
+      if (*iter != '{' && *iter != '}') {
+        ++iter;
+        continue;
+      }
+      // Escaped braces end the current literal after the first of them
+      if (iter + 1 != end && iter[1] == *iter) {
+        segments.push_back(Segment{{literal, std::size_t(iter + 1 - literal)}, -1, {}, {}});
+        literal = iter += 2;
+        continue;
+      }
+      if (*iter == '}') return false;
+
+      Segment segment{{literal, std::size_t(iter - literal)}, -1, {}, {}};
+      if (++iter != end && *iter >= '0' && *iter <= '9') {
+        for (segment.arg = 0; iter != end && *iter >= '0' && *iter <= '9'; ++iter)
+          segment.arg = segment.arg * 10 + (*iter - '0');
+        context.check_arg_id(segment.arg);
+      } else {
+        segment.arg = context.next_arg_id();
+      }
+      if (iter == end || (*iter != ':' && *iter != '}')) return false;
+      if (*iter == ':') ++iter;
+
+      auto arg = args.get(segment.arg);
+      if (!arg) return false;
+      const char *spec_end = nullptr;
+      context.advance_to(iter);
+      fmt::visit_format_arg(
+          [&](auto value) {
+            using T = decltype(value);
+            if constexpr (is_cached<T>) {
+              auto &formatter = segment.formatter.template emplace<fmt::formatter<T>>();
+              spec_end        = formatter.parse(context);
+            }
+          },
+          arg);
+      if (!spec_end) spec_end = skip_spec(iter, end);
+      if (spec_end == end || *spec_end != '}') return false;
+      segment.spec = std::string_view(iter, spec_end - iter);
+      if (segment.spec.find("{}") != segment.spec.npos) return false;
+      segments.push_back(std::move(segment));
+      literal = iter = spec_end + 1;
+    }
+    segments.push_back(Segment{{literal, std::size_t(end - literal)}, -1, {}, {}});
+    return true;
+  }
+
+  // L specs use the global locale. Returns false without formatting anything if a field depends on
+  // locale, which is not nullptr, see uses_locale.
+  bool format(fmt::memory_buffer &buffer, fmt::format_args args,
+              const std::locale *locale = nullptr) {
+    if (locale)
+      for (const Segment &segment : segments)
+        if (segment.arg >= 0 && uses_locale(segment.spec, args.get(segment.arg))) return false;
+    fmt::format_context context(fmt::appender(buffer), args);
+    for (Segment &segment : segments) {
+      buffer.append(segment.literal.data(), segment.literal.data() + segment.literal.size());
+      if (segment.arg < 0) continue;
+      auto arg    = args.get(segment.arg);
+      bool cached = false;
+      fmt::visit_format_arg(
+          [&](auto value) {
+            using T = decltype(value);
+            if constexpr (is_cached<T>) {
+              if (auto formatter = std::get_if<fmt::formatter<T>>(&segment.formatter)) {
+                context.advance_to(formatter->format(value, context));
+                cached = true;
+              }
+            }
+          },
+          arg);
+      // The string has been parsed for different argument types
+      if (!cached) format_arg(context, segment.spec, arg);
+    }
+    return true;
+  }
+
+ private:
+  template <typename... T>
+  using Formatters = std::variant<std::monostate, fmt::formatter<T>...>;
+  using Formatter  = Formatters<int, unsigned, long long, unsigned long long, bool, char, float,
+                               double, long double, const char *, fmt::string_view, const void *>;
+  template <typename T, typename Variant>
+  struct is_alternative;
+  template <typename T, typename... Alternatives>
+  struct is_alternative<T, std::variant<Alternatives...>> :
+      std::bool_constant<(std::is_same_v<fmt::formatter<T>, Alternatives> || ...)> {};
+  // Argument types whose parsed specs are stored
+  template <typename T>
+  static constexpr bool is_cached = is_alternative<T, Formatter>::value;
+
+  struct Segment {
+    // Text in front of the field
+    std::string_view literal;
+    // -1 if the segment only consists of text
+    int arg = -1;
+    std::string_view spec;
+    Formatter formatter;
+  };
+
+  // Finds the end of a spec which contains nested replacement fields.
+  static const char *skip_spec(const char *iter, const char *end) {
+    for (int depth = 0; iter != end; ++iter) {
+      if (*iter == '{')
+        ++depth;
+      else if (*iter == '}' && !depth--)
+        return iter;
+    }
+    return end;
+  }
+
+  std::vector<Segment> segments;
+};
+
+// A direct mapped cache of parsed format strings, keyed by the address of the string. Format
+// strings of runtime messages or of unloaded catalogs can reuse an address for other text, so
+// hits are checked against a copy of the string.
+class FormatCache {
+ public:
+  static constexpr std::size_t size = I18N_FORMAT_CACHE_SIZE;
+  static_assert(size && !(size & (size - 1)), "I18N_FORMAT_CACHE_SIZE has to be a power of two");
+
+  void vformat_to(fmt::memory_buffer &buffer, std::string_view format, fmt::format_args args,
+                  const std::locale *locale = nullptr) {
+    const unsigned generation = catalog_generation();
+    Entry &entry = entries[(reinterpret_cast<std::uintptr_t>(format.data()) >> 3) & (size - 1)];
+    if (entry.format != format.data() || entry.generation != generation
+        || entry.text != format) {
+      entry.format     = nullptr;
+      entry.valid      = entry.parsed.parse(format, args);
+      entry.format     = format.data();
+      entry.text       = format;
+      entry.generation = generation;
+    }
+    if (entry.valid && entry.parsed.format(buffer, args, locale))
+      return;
+    if (locale)
+      fmt::vformat_to(fmt::appender(buffer), *locale, format, args);
+    else
+      fmt::vformat_to(fmt::appender(buffer), format, args);
+  }
+
+ private:
+  struct Entry {
+    const char *format  = nullptr;
+    std::string text;
+    unsigned generation = 0;
+    bool valid          = false;
+    ParsedFormat parsed;
+  };
+
+  Entry entries[size];
+};
+
+inline thread_local FormatCache format_cache;
+#endif
+
+// Output iterator which forwards the first limit characters to out and counts all of them.
+template <typename OutputIt>
+struct TruncatingIterator {
+  using iterator_category = std::output_iterator_tag;
+  using value_type        = void;
+  using difference_type   = std::ptrdiff_t;
+  using pointer           = void;
+  using reference         = void;
+
+  TruncatingIterator &operator*() { return *this; }
+  TruncatingIterator &operator++() { return *this; }
+  TruncatingIterator &operator++(int) { return *this; }
+  template <typename Char>
+  TruncatingIterator &operator=(Char c) {
+    if (count++ < limit) *out++ = c;
+    return *this;
+  }
+
+  OutputIt out;
+  std::size_t limit;
+  std::size_t count = 0;
+};
+
+// Calls format and records how long it took, see I18N_STATS.
+template <typename Format>
+auto timed(Format &&format) {
+  StatsTimer timer;
+  auto result = std::forward<Format>(format)();
+  record_format(timer);
+  return result;
+}
+
+// Formatting with format strings only known at runtime. The arguments must have been checked
+// against the untranslated strings already. L specs use locale, or the global locale if it is
+// nullptr.
+template <typename... Args>
+std::string format(const std::locale *locale, std::string_view format, const Args &...args) {
+  return timed([&] {
+#if I18N_CACHE_FORMATS && USE_FMT
+    fmt::memory_buffer buffer;
+    format_cache.vformat_to(buffer, format, fmt::make_format_args(args...), locale);
+    return fmt::to_string(buffer);
+#else
+    if (locale) return fmtstd::vformat(*locale, format, fmtstd::make_format_args(args...));
+    return fmtstd::vformat(format, fmtstd::make_format_args(args...));
+#endif
+  });
+}
+template <typename OutputIt, typename... Args>
+OutputIt format_to(const std::locale *locale, OutputIt out, std::string_view format,
+                   const Args &...args) {
+  return timed([&] {
+#if I18N_CACHE_FORMATS && USE_FMT
+    fmt::memory_buffer buffer;
+    format_cache.vformat_to(buffer, format, fmt::make_format_args(args...), locale);
+    return std::copy(buffer.begin(), buffer.end(), std::move(out));
+#else
+    if (locale)
+      return fmtstd::vformat_to(std::move(out), *locale, format,
+                                fmtstd::make_format_args(args...));
+    return fmtstd::vformat_to(std::move(out), format, fmtstd::make_format_args(args...));
+#endif
+  });
+}
+// Wide format strings are not cached.
+template <typename... Args>
+std::wstring format(const std::locale *locale, std::wstring_view format, const Args &...args) {
+  return timed([&] {
+    fmtstd::basic_string_view<wchar_t> view(format.data(), format.size());
+    if (locale) return fmtstd::vformat(*locale, view, fmtstd::make_wformat_args(args...));
+    return fmtstd::vformat(view, fmtstd::make_wformat_args(args...));
+  });
+}
+template <typename OutputIt, typename... Args>
+OutputIt format_to(const std::locale *locale, OutputIt out, std::wstring_view format,
+                   const Args &...args) {
+  return timed([&] {
+    fmtstd::basic_string_view<wchar_t> view(format.data(), format.size());
+    if (locale)
+      return fmtstd::vformat_to(std::move(out), *locale, view, fmtstd::make_wformat_args(args...));
+    return fmtstd::vformat_to(std::move(out), view, fmtstd::make_wformat_args(args...));
+  });
+}
+template <typename Char, typename... Args>
+std::basic_string<Char> format(std::basic_string_view<Char> format, const Args &...args) {
+  return detail::format(nullptr, format, args...);
+}
+template <typename OutputIt, typename Char, typename... Args>
+OutputIt format_to(OutputIt out, std::basic_string_view<Char> format, const Args &...args) {
+  return detail::format_to(nullptr, std::move(out), format, args...);
+}
+
+template <typename OutputIt, typename Char, typename... Args>
+fmtstd::format_to_n_result<OutputIt> format_to_n(const std::locale *locale, OutputIt out,
+                                                 std::size_t n,
+                                                 std::basic_string_view<Char> format,
+                                                 const Args &...args) {
+  auto result = detail::format_to(locale, TruncatingIterator<OutputIt>{std::move(out), n}, format,
+                                  args...);
+  using Result = fmtstd::format_to_n_result<OutputIt>;
+  return Result{std::move(result.out), static_cast<decltype(Result::size)>(result.count)};
+}
+template <typename Char, typename... Args>
+std::size_t formatted_size(const std::locale *locale, std::basic_string_view<Char> format,
+                           const Args &...args) {
+  return detail::format_to(locale, TruncatingIterator<Char *>{nullptr, 0}, format, args...).count;
+}
+
+// The locale for L specs in the translations of catalog. Catalogs which know the language of
+// their translations provide
+//
+//   const std::locale *format_locale() const;
+//
+// which returns a locale built once for that language, or nullptr to use the global locale.
+template <typename Catalog>
+const std::locale *format_locale_of(const Catalog &catalog) {
+  if constexpr (requires {
+                  { catalog.format_locale() } -> std::convertible_to<const std::locale *>;
+                })
+    return catalog.format_locale();
+  else
+    return nullptr;
+}
+
+// Catalogs which store their format strings pre-parsed, like CompiledCatalog from
+// i18n/catalog.hpp, provide
+//
+//   void vformat_to(fmt::memory_buffer &buffer, std::string_view format, fmt::format_args args);
+//
+// which is used to format their translations. Other catalogs use format.
+template <typename Catalog, typename Char, typename... Args>
+std::basic_string<Char> format_in(const Catalog &catalog, std::basic_string_view<Char> format,
+                                  const Args &...args) {
+#if USE_FMT
+  if constexpr (std::is_same_v<Char, char>
+                && requires(fmt::memory_buffer &buffer, fmt::format_args arguments) {
+                     catalog.vformat_to(buffer, format, arguments);
+                   })
+    return timed([&] {
+      fmt::memory_buffer buffer;
+      catalog.vformat_to(buffer, format, fmt::make_format_args(args...));
+      return fmt::to_string(buffer);
+    });
+#endif
+  return detail::format(format_locale_of(catalog), format, args...);
+}
+template <typename Catalog, typename OutputIt, typename Char, typename... Args>
+OutputIt format_to_in(const Catalog &catalog, OutputIt out, std::basic_string_view<Char> format,
+                      const Args &...args) {
+  return detail::format_to(format_locale_of(catalog), std::move(out), format, args...);
+}
+template <typename Catalog, typename OutputIt, typename Char, typename... Args>
+fmtstd::format_to_n_result<OutputIt> format_to_n_in(const Catalog &catalog, OutputIt out,
+                                                    std::size_t n,
+                                                    std::basic_string_view<Char> format,
+                                                    const Args &...args) {
+  return detail::format_to_n(format_locale_of(catalog), std::move(out), n, format, args...);
+}
+template <typename Catalog, typename Char, typename... Args>
+std::size_t formatted_size_in(const Catalog &catalog, std::basic_string_view<Char> format,
+                              const Args &...args) {
+  return detail::formatted_size(format_locale_of(catalog), format, args...);
+}
+
+} // namespace detail
+} // namespace mfk::i18n
+
+#endif
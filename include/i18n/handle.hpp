@@ -0,0 +1,142 @@
+#ifndef I18N_HANDLE_HPP
+#define I18N_HANDLE_HPP
+
+#include "../i18n.hpp"
+
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mfk::i18n {
+
+namespace detail {
+template <typename Message>
+concept registered_message = requires {
+  { Message::info() } -> std::same_as<const MessageInfo &>;
+  { Message::has_plural } -> std::convertible_to<bool>;
+};
+
+// Common part of MessageHandle and PluralMessageHandle.
+class MessageHandleBase {
+ public:
+  // The index of the message in messages(). Indices are assigned in registration order, so they
+  // can be stored and exchanged within a process, but they are not stable across runs.
+  constexpr std::uint32_t index() const { return id; }
+  // Default constructed handles are empty and must not be translated.
+  constexpr bool empty() const { return id == std::uint32_t(-1); }
+  const MessageInfo &info() const {
+    assert(!empty());
+    return *message_registry().get(id);
+  }
+
+ protected:
+  constexpr MessageHandleBase() = default;
+  constexpr explicit MessageHandleBase(std::uint32_t id): id(id) {}
+
+  const MessageInfo *get_info() const { return &info(); }
+  const char *get_domain() const { return info().domain; }
+  const char *get_msgid() const { return info().msgid; }
+  const char *get_singular() const { return info().singular; }
+
+  std::uint32_t id = -1;
+};
+} // namespace detail
+
+// A message without plural forms stored as the 4 byte index of its registry entry, see
+// messages(). Handles are trivially copyable and translate like the other string classes, so
+// large tables of untranslated messages can store them instead of two to four pointers.
+//
+// Literals have registry entries already. Messages which are only known at runtime get one
+// through intern(), which copies their strings and keeps them until the program ends. Handles
+// always translate to UTF-8, also for literals of other character types.
+class MessageHandle :
+    public detail::MessageHandleBase,
+    public detail::I18NStringImpl<MessageHandle> {
+  using I18NStringImpl = detail::I18NStringImpl<MessageHandle>;
+  friend I18NStringImpl;
+
+ public:
+  constexpr MessageHandle() = default;
+  // Literals which haven't registered themselves yet, e.g. during static initialization, are
+  // registered here.
+  template <detail::registered_message Message>
+  requires(!Message::has_plural)
+  MessageHandle(const Message &): MessageHandleBase(detail::registered_index(Message::info())) {}
+  explicit MessageHandle(const I18NStringCrossDomain &message):
+      MessageHandle(intern(message.domain, message.msgid, message.singular)) {}
+
+  static MessageHandle from_index(std::uint32_t index) { return MessageHandle(index); }
+  // msgid is "msgctxt\4msgid" or just "msgid", singular is used if there is no translation.
+  static MessageHandle intern(const char *domain, const char *msgid, const char *singular) {
+    return MessageHandle(
+        detail::interned_messages().get(domain, msgid, singular, nullptr).index());
+  }
+  static MessageHandle intern(const char *domain, const char *msgid) {
+    const char *singular = std::strchr(msgid, '\4');
+    return intern(domain, msgid, singular ? singular + 1 : msgid);
+  }
+
+  explicit operator I18NStringCrossDomain() const {
+    return I18NStringCrossDomain(info().domain, info().msgid, info().singular);
+  }
+
+  friend constexpr bool operator==(MessageHandle a, MessageHandle b) { return a.id == b.id; }
+
+ private:
+  constexpr explicit MessageHandle(std::uint32_t id): MessageHandleBase(id) {}
+
+  using MessageHandleBase::get_domain, MessageHandleBase::get_msgid,
+      MessageHandleBase::get_singular, MessageHandleBase::get_info;
+};
+
+// Same as MessageHandle, but for messages with plural forms.
+class PluralMessageHandle :
+    public detail::MessageHandleBase,
+    public detail::I18NPluralStringImpl<PluralMessageHandle> {
+  using I18NPluralStringImpl = detail::I18NPluralStringImpl<PluralMessageHandle>;
+  friend I18NPluralStringImpl;
+
+ public:
+  constexpr PluralMessageHandle() = default;
+  template <detail::registered_message Message>
+  requires(Message::has_plural)
+  PluralMessageHandle(const Message &):
+      MessageHandleBase(detail::registered_index(Message::info())) {}
+  explicit PluralMessageHandle(const I18NPluralStringCrossDomain &message):
+      PluralMessageHandle(
+          intern(message.domain, message.msgid, message.singular, message.plural)) {}
+
+  static PluralMessageHandle from_index(std::uint32_t index) { return PluralMessageHandle(index); }
+  // msgid is "msgctxt\4msgid" or just "msgid", singular is used if there is no translation.
+  static PluralMessageHandle intern(const char *domain, const char *msgid, const char *singular,
+                                    const char *plural) {
+    return PluralMessageHandle(
+        detail::interned_messages().get(domain, msgid, singular, plural).index());
+  }
+
+  explicit operator I18NPluralStringCrossDomain() const {
+    return I18NPluralStringCrossDomain(info().domain, info().msgid, info().singular,
+                                       info().plural);
+  }
+
+  friend constexpr bool operator==(PluralMessageHandle a, PluralMessageHandle b) {
+    return a.id == b.id;
+  }
+
+ private:
+  constexpr explicit PluralMessageHandle(std::uint32_t id): MessageHandleBase(id) {}
+
+  const char *get_plural() const { return info().plural; }
+  using MessageHandleBase::get_domain, MessageHandleBase::get_msgid,
+      MessageHandleBase::get_singular, MessageHandleBase::get_info;
+};
+
+static_assert(sizeof(MessageHandle) == 4 && std::is_trivially_copyable_v<MessageHandle>);
+static_assert(sizeof(PluralMessageHandle) == 4
+              && std::is_trivially_copyable_v<PluralMessageHandle>);
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef I18N_HASH_HPP
+#define I18N_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace mfk::i18n {
+
+// Hashes of a lookup key ("msgctxt\4msgid" or just "msgid"). All functions are constexpr, so the
+// hashes of literals are computed at compile time. For character types wider than char every code
+// unit is treated as a single input value.
+struct MessageHash {
+  // The hashpjw function used by the hash tables in .mo files.
+  std::uint32_t pjw;
+  // A faster hash with better distribution, intended for custom backends.
+  std::uint64_t fast;
+};
+
+template <typename Char>
+constexpr std::uint32_t hash_pjw(std::basic_string_view<Char> key) {
+  std::uint32_t hash = 0;
+  for (Char c : key) {
+    hash = (hash << 4) + static_cast<std::make_unsigned_t<Char>>(c);
+    if (std::uint32_t high = hash & 0xf0000000u) hash ^= (high >> 24) ^ high;
+  }
+  return hash;
+}
+constexpr std::uint32_t hash_pjw(std::string_view key) { return hash_pjw<char>(key); }
+
+// Processes eight code units at a time and finishes with the finalizer of MurmurHash3. Assembling
+// the words bytewise keeps the function usable in constant expressions; optimizers turn this into
+// plain loads at runtime.
+template <typename Char>
+constexpr std::uint64_t hash_fast(std::basic_string_view<Char> key) {
+  constexpr std::uint64_t multiplier = 0x9e3779b97f4a7c15u;
+  auto word = [&](std::size_t begin, std::size_t end) {
+    std::uint64_t result = 0;
+    for (auto i = begin; i != end; ++i)
+      result |= std::uint64_t(static_cast<std::make_unsigned_t<Char>>(key[i])) << 8 * (i - begin);
+    return result;
+  };
+  std::uint64_t hash = key.size() * multiplier;
+  std::size_t i      = 0;
+  for (; i + 8 <= key.size(); i += 8) {
+    hash = (hash ^ word(i, i + 8)) * multiplier;
+    hash ^= hash >> 32;
+  }
+  hash = (hash ^ word(i, key.size())) * multiplier;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdu;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53u;
+  hash ^= hash >> 33;
+  return hash;
+}
+constexpr std::uint64_t hash_fast(std::string_view key) { return hash_fast<char>(key); }
+
+template <typename Char>
+constexpr MessageHash hash_message(std::basic_string_view<Char> key) {
+  return {hash_pjw(key), hash_fast(key)};
+}
+constexpr MessageHash hash_message(std::string_view key) { return hash_message<char>(key); }
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,422 @@
+#ifndef I18N_IMAGE_HPP
+#define I18N_IMAGE_HPP
+
+#include "cache.hpp"
+#include "format.hpp"
+#include "mo.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <locale>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if I18N_HAS_MMAP && defined(__linux__)
+  #define I18N_HAS_MEMFD 1
+#else
+  #define I18N_HAS_MEMFD 0
+#endif
+
+namespace mfk::i18n {
+
+// The merged catalogs of a Locale compiled into a single read-only image, which contains the hash
+// tables of all domains and all strings. The image only uses offsets, so it can be mapped at any
+// address and is never written to after it has been created. All processes mapping the same file
+// or memfd therefore share its pages, e.g. pre-forked workers, and opening an image neither parses
+// the catalogs nor copies any strings.
+//
+// Images are compiled for the byte order of the host which creates them and are not meant to be
+// distributed. Lookups behave like the ones of the Locale the image was compiled from.
+class CatalogImage {
+ public:
+  // An image without any catalogs, all messages stay untranslated.
+  CatalogImage() = default;
+  // Throws std::system_error if the image can not be read and std::runtime_error if it is not a
+  // valid image.
+  explicit CatalogImage(const std::filesystem::path &path) {
+#if I18N_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path.string());
+    try {
+      map(fd);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::system_error(errno, std::generic_category(), path.string());
+    size_       = std::filesystem::file_size(path);
+    char *owned = new char[size_];
+    data        = owned;
+    if (!file.read(owned, size_)) {
+      unmap();
+      throw std::runtime_error("Unable to read catalog image");
+    }
+#endif
+    try {
+      open();
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+#if I18N_HAS_MMAP
+  // Maps the image in fd, e.g. a memfd created with memfd(). fd can be closed afterwards.
+  explicit CatalogImage(int fd) {
+    map(fd);
+    try {
+      open();
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+#endif
+  CatalogImage(const CatalogImage &)            = delete;
+  CatalogImage &operator=(const CatalogImage &) = delete;
+  ~CatalogImage() { unmap(); }
+
+  // Compiles the image of locale.
+  static std::string compile(const Locale &locale);
+  // Writes the image of locale to a temporary file which is then renamed to path, so processes
+  // which have mapped an older image keep using it.
+  static void write(const Locale &locale, const std::filesystem::path &path) {
+    std::string image = compile(locale);
+    auto temporary    = path;
+    temporary += ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      if (!file.write(image.data(), image.size()) || !file.flush())
+        throw std::system_error(errno, std::generic_category(), temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+  }
+#if I18N_HAS_MEMFD
+  // Returns a memfd containing the image of locale, which is sealed against modifications. Workers
+  // forked afterwards can map it through CatalogImage(fd).
+  static int memfd(const Locale &locale) {
+    std::string image = compile(locale);
+    int fd            = ::memfd_create("i18n-catalogs", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "memfd_create");
+    for (std::size_t written = 0; written != image.size();) {
+      ssize_t result = ::write(fd, image.data() + written, image.size() - written);
+      if (result < 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "write");
+      }
+      written += result;
+    }
+    if (::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "fcntl(F_ADD_SEALS)");
+    }
+    return fd;
+  }
+#endif
+
+  std::string_view languages() const { return data ? string(read(12), read(16)) : "C"; }
+  std::string_view default_domain() const {
+    return data ? string(read(20), read(24)) : "messages";
+  }
+  // Used for L format specs in translations, see Locale::format_locale.
+  const std::locale *format_locale() const {
+    return format_locale_ ? &*format_locale_ : nullptr;
+  }
+  // translation, which was returned by this image, converted to Char, see Locale::transcoded.
+  template <typename Char>
+  std::basic_string_view<Char> transcoded(std::string_view translation) const {
+    return transcoded_.get<Char>(translation);
+  }
+  // Size of the image in bytes
+  std::size_t size() const { return size_; }
+
+  // Lookups with the semantics of dgettext and dngettext, see i18n/backend.hpp. The results are
+  // NUL terminated.
+  std::string_view translate(const char *domain, const char *msgid) const {
+    std::string_view key = msgid;
+    return translate(domain, key, hash_pjw(key));
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n) const {
+    std::string_view key = msgid;
+    return translate(domain, key, plural, n, hash_pjw(key));
+  }
+  // Literals use the hashes computed at compile time.
+  std::string_view translate(const char *domain, const char *msgid,
+                             const MessageHash &hash) const {
+    return translate(domain, msgid, hash.pjw);
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n, const MessageHash &hash) const {
+    return translate(domain, msgid, plural, n, hash.pjw);
+  }
+
+  // The locale of the catalog which provided the translation of key, see Locale::origin.
+  std::string_view origin(const char *domain, std::string_view key) const {
+    if (const Domain *catalogs = find(domain))
+      if (std::uint32_t entry = lookup(*catalogs, key, hash_pjw(key)))
+        return catalogs->catalogs[read(entry + 16)].locale;
+    return {};
+  }
+
+ private:
+  // All numbers are 32 bit in host byte order. The header consists of the magic number, the size
+  // of the image, a reserved word, the offsets and lengths of languages and the default domain,
+  // the number of domains and the offset of their table. Every domain consists of the offset and
+  // length of its name and the counts and offsets of its catalogs, entries and hash table slots.
+  // Catalogs are the offsets and lengths of their locale and header, entries the offsets and
+  // lengths of key and translation and the index of their catalog, and slots the hash and one more
+  // than the index of their entry, as in Locale. Strings are NUL terminated.
+  static constexpr std::uint32_t magic        = 0x4d493831;
+  static constexpr std::uint32_t header_size  = 36;
+  static constexpr std::uint32_t domain_size  = 32;
+  static constexpr std::uint32_t catalog_size = 16;
+  static constexpr std::uint32_t entry_size   = 20;
+  static constexpr std::uint32_t slot_size    = 8;
+
+  struct Catalog {
+    std::string_view locale;
+    PluralForms plural_forms;
+  };
+  struct Domain {
+    std::string_view name;
+    std::vector<Catalog> catalogs;
+    std::uint32_t entries;
+    std::uint32_t slots;
+    std::uint32_t slot_count;
+  };
+
+  std::uint32_t read(std::uint32_t offset) const {
+    std::uint32_t value;
+    std::memcpy(&value, data + offset, sizeof value);
+    return value;
+  }
+  std::string_view string(std::uint32_t offset, std::uint32_t length) const {
+    return {data + offset, length};
+  }
+
+  // Checks all tables and strings once, so that lookups can trust them.
+  void open() {
+    auto invalid = [] { throw std::runtime_error("Invalid catalog image"); };
+    auto fits    = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+      return offset % 4 == 0 && offset + count * size <= size_;
+    };
+    auto check_string = [&](std::uint32_t offset) {
+      std::uint64_t end = std::uint64_t(read(offset)) + read(offset + 4);
+      if (end >= size_ || data[end]) invalid();
+      return string(read(offset), read(offset + 4));
+    };
+    if (size_ < header_size || read(0) != magic || read(4) != size_) invalid();
+    format_locale_ = detail::std_locale_for(check_string(12));
+    check_string(20);
+    std::uint32_t count = read(28), table = read(32);
+    if (!fits(table, count, domain_size)) invalid();
+    domains.reserve(count);
+    for (std::uint32_t i = 0; i != count; ++i) {
+      std::uint32_t offset = table + i * domain_size;
+      Domain &domain       = domains.emplace_back();
+      domain.name          = check_string(offset);
+      std::uint32_t catalogs = read(offset + 8), entries = read(offset + 16);
+      domain.entries    = read(offset + 20);
+      domain.slot_count = read(offset + 24);
+      domain.slots      = read(offset + 28);
+      if (!fits(read(offset + 12), catalogs, catalog_size)
+          || !fits(domain.entries, entries, entry_size)
+          || !fits(domain.slots, domain.slot_count, slot_size)
+          || (domain.slot_count && !std::has_single_bit(domain.slot_count)))
+        invalid();
+      for (std::uint32_t j = 0; j != catalogs; ++j) {
+        std::uint32_t catalog = read(offset + 12) + j * catalog_size;
+        auto plural_forms     = PluralForms::from_header_or_default(check_string(catalog + 8));
+        domain.catalogs.push_back(Catalog{check_string(catalog), std::move(plural_forms)});
+      }
+      for (std::uint32_t j = 0; j != entries; ++j) {
+        std::uint32_t entry = domain.entries + j * entry_size;
+        check_string(entry);
+        check_string(entry + 8);
+        if (read(entry + 16) >= catalogs) invalid();
+      }
+      for (std::uint32_t j = 0; j != domain.slot_count; ++j)
+        if (read(domain.slots + j * slot_size + 4) > entries) invalid();
+    }
+  }
+
+  const Domain *find(const char *name) const {
+    std::string_view wanted = name ? name : default_domain();
+    for (auto &domain : domains)
+      if (domain.name == wanted) return &domain;
+    return nullptr;
+  }
+  // Returns the offset of the entry, or 0 if the key is not translated. Same as Locale::Domain.
+  std::uint32_t lookup(const Domain &domain, std::string_view key, std::uint32_t hash) const {
+    // The slot count is a power of two, but the image may not contain empty slots.
+    const std::uint64_t mixed = hash * 0x9e3779b9u;
+    auto slot                 = static_cast<std::uint32_t>(mixed * domain.slot_count >> 32);
+    for (std::uint32_t probes = 0; probes != domain.slot_count; ++probes) {
+      std::uint32_t offset = domain.slots + slot * slot_size, index = read(offset + 4);
+      if (!index) return 0;
+      std::uint32_t entry = domain.entries + (index - 1) * entry_size;
+      if (read(offset) == hash && string(read(entry), read(entry + 4)) == key) return entry;
+      slot = (slot + 1) & (domain.slot_count - 1);
+    }
+    return 0;
+  }
+
+  std::string_view translate(const char *domain, std::string_view key, std::uint32_t hash) const {
+    if (const Domain *catalogs = find(domain))
+      if (std::uint32_t entry = lookup(*catalogs, key, hash))
+        return MoFile::first_form(string(read(entry + 8), read(entry + 12)));
+    return key;
+  }
+  std::string_view translate(const char *domain, std::string_view key, const char *plural,
+                             unsigned long n, std::uint32_t hash) const {
+    if (const Domain *catalogs = find(domain))
+      if (std::uint32_t entry = lookup(*catalogs, key, hash)) {
+        std::string_view forms = string(read(entry + 8), read(entry + 12));
+        std::string_view form  = MoFile::first_form(forms);
+        for (auto i = catalogs->catalogs[read(entry + 16)].plural_forms(n); i; --i) {
+          // Missing forms fall back to the first one, as in libintl.
+          if (form.size() == forms.size()) return MoFile::first_form(forms);
+          forms.remove_prefix(form.size() + 1);
+          form = MoFile::first_form(forms);
+        }
+        return form;
+      }
+    return n == 1 ? key : plural;
+  }
+
+#if I18N_HAS_MMAP
+  void map(int fd) {
+    struct stat info {};
+    if (::fstat(fd, &info)) throw std::system_error(errno, std::generic_category(), "fstat");
+    if (std::uint64_t(info.st_size) < header_size || info.st_size > 0xffffffff)
+      throw std::runtime_error("Invalid catalog image");
+    void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap");
+    data  = static_cast<const char *>(mapping);
+    size_ = info.st_size;
+  }
+  void unmap() {
+    if (data) ::munmap(const_cast<char *>(data), size_);
+  }
+#else
+  void unmap() { delete[] data; }
+#endif
+
+  const char *data  = nullptr;
+  std::size_t size_ = 0;
+  std::vector<Domain> domains;
+  std::optional<std::locale> format_locale_;
+  detail::TranscodedStrings transcoded_;
+};
+
+inline std::string CatalogImage::compile(const Locale &locale) {
+  std::vector<const Locale::Domain *> domains;
+  if (locale.data)
+    for (auto &domain : locale.data->domains)
+      domains.push_back(&domain);
+
+  // The tables come first, the strings are appended behind them.
+  std::uint64_t size = header_size + domain_size * domains.size();
+  for (auto *domain : domains)
+    size += catalog_size * domain->catalogs.size() + entry_size * domain->entries.size()
+            + slot_size * domain->slots.size();
+  std::string image(size, '\0');
+  auto put = [&](std::uint64_t offset, std::uint64_t value) {
+    if (value > 0xffffffff) throw std::length_error("Catalog image is too large");
+    auto word = static_cast<std::uint32_t>(value);
+    std::memcpy(image.data() + offset, &word, sizeof word);
+  };
+  // Writes the offset and length of str to offset.
+  auto put_string = [&](std::uint64_t offset, std::string_view str) {
+    put(offset, image.size());
+    put(offset + 4, str.size());
+    image.append(str).append(1, '\0');
+  };
+
+  put(0, magic);
+  put_string(12, locale.languages());
+  put_string(20, locale.default_domain());
+  put(28, domains.size());
+  put(32, header_size);
+  std::uint64_t table = header_size + domain_size * domains.size();
+  for (std::size_t i = 0; i != domains.size(); ++i) {
+    const Locale::Domain &domain = *domains[i];
+    std::uint64_t offset         = header_size + i * domain_size;
+    put_string(offset, domain.name);
+    put(offset + 8, domain.catalogs.size());
+    put(offset + 12, table);
+    for (auto &catalog : domain.catalogs) {
+      put_string(table, catalog.locale);
+      put_string(table + 8, catalog.file->header());
+      table += catalog_size;
+    }
+    put(offset + 16, domain.entries.size());
+    put(offset + 20, table);
+    for (auto &entry : domain.entries) {
+      put_string(table, entry.key);
+      put_string(table + 8, entry.translation);
+      put(table + 16, entry.catalog);
+      table += entry_size;
+    }
+    put(offset + 24, domain.slots.size());
+    put(offset + 28, table);
+    for (auto [hash, index] : domain.slots) {
+      put(table, hash);
+      put(table + 4, index);
+      table += slot_size;
+    }
+  }
+  put(4, image.size());
+  if (image.size() > 0xffffffff) throw std::length_error("Catalog image is too large");
+  return image;
+}
+
+// A backend using the CatalogImage installed by set_image, e.g. by every worker process after it
+// has mapped the image created by its parent. Select it with
+// I18N_BACKEND=::mfk::i18n::ImageBackend. Messages stay untranslated until an image is installed.
+class ImageBackend {
+ public:
+  template <typename... Args>
+  static std::string_view translate(const Args &...args) {
+    return image().translate(args...);
+  }
+
+  static const std::locale *format_locale() { return image().format_locale(); }
+  template <typename Char>
+  static std::basic_string_view<Char> transcoded(std::string_view translation) {
+    return image().transcoded<Char>(translation);
+  }
+
+  static const CatalogImage &image() {
+    const CatalogImage *installed = current.load(std::memory_order_acquire);
+    return installed ? *installed : untranslated;
+  }
+  // Lookups don't take locks, so image has to stay alive as long as translations are used, usually
+  // until the process exits.
+  static void set_image(const CatalogImage *image) {
+    current.store(image, std::memory_order_release);
+    invalidate_translations();
+  }
+
+ private:
+  static inline const CatalogImage untranslated;
+  static inline std::atomic<const CatalogImage *> current{nullptr};
+};
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,867 @@
+#ifndef I18N_MO_HPP
+#define I18N_MO_HPP
+
+#include "backend.hpp"
+#include "cache.hpp"
+#include "embedded.hpp"
+#include "format.hpp"
+#include "hash.hpp"
+#include "plural.hpp"
+#include "registry.hpp"
+#include "transcode.hpp"
+#include "validate.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define I18N_HAS_MMAP 1
+#else
+  #include <fstream>
+  #define I18N_HAS_MMAP 0
+#endif
+
+// Directory used for text domains which were not bound to a directory explicitly.
+#ifndef I18N_DEFAULT_LOCALEDIR
+  #define I18N_DEFAULT_LOCALEDIR "/usr/share/locale"
+#endif
+
+namespace mfk::i18n {
+
+// A read-only view of a compiled message catalog in GNU .mo format. The file is mapped into memory
+// and all lookups are done through the hash table stored in the file, so loading is cheap and
+// lookups don't allocate.
+class MoFile {
+ public:
+  // Throws std::system_error if the file can not be read and std::runtime_error if it is not a
+  // valid .mo file.
+  explicit MoFile(const std::filesystem::path &path) {
+    map(path);
+    try {
+      validate();
+      if (auto header = find(""); header.data())
+        plural_forms_ = PluralForms::from_header_or_default(header.data());
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+  // Uses a catalog which is already in memory, e.g. an EmbeddedCatalog. The data is not copied, so
+  // it has to outlive the MoFile.
+  MoFile(const char *data, std::size_t size): data(data), size_(size) {
+    validate();
+    if (auto header = find(""); header.data())
+      plural_forms_ = PluralForms::from_header_or_default(header.data());
+  }
+  MoFile(const MoFile &)            = delete;
+  MoFile &operator=(const MoFile &) = delete;
+  ~MoFile() { unmap(); }
+
+  // Number of entries, including the header entry.
+  std::uint32_t size() const { return count; }
+
+  // Looks up key, which is the msgid optionally prefixed by its context followed by '\4'.
+  // Returns the translation or an empty view with a null data() pointer if the catalog does not
+  // contain it. For entries with plural forms this is the first form. All returned views are NUL
+  // terminated.
+  std::string_view find(std::string_view key) const { return find(key, hash_pjw(key)); }
+  std::string_view find(std::string_view key, std::uint32_t hash) const {
+    std::uint32_t index = lookup(key, hash);
+    if (index == not_found) return {};
+    // Only the originals of entries with plural forms are longer than their key.
+    std::string_view forms = entry(index);
+    return read(originals + 8 * index) == key.size() ? forms : first_form(forms);
+  }
+
+  // Returns the plural form for n or an empty view with a null data() pointer if the catalog does
+  // not contain key.
+  std::string_view find_plural(std::string_view key, unsigned long n) const {
+    return find_plural(key, hash_pjw(key), n);
+  }
+  std::string_view find_plural(std::string_view key, std::uint32_t hash, unsigned long n) const {
+    std::uint32_t index = lookup(key, hash);
+    return index != not_found ? plural_form(entry(index), n) : std::string_view();
+  }
+
+  // Returns the complete translation of key, i.e. all plural forms separated by NUL characters, or
+  // an empty view with a null data() pointer if the catalog does not contain key.
+  std::string_view find_entry(std::string_view key, std::uint32_t hash) const {
+    std::uint32_t index = lookup(key, hash);
+    return index != not_found ? entry(index) : std::string_view();
+  }
+
+  // Selects the plural form for n from a complete translation returned by find_entry.
+  std::string_view plural_form(std::string_view forms, unsigned long n) const {
+    std::string_view form = first_form(forms);
+    for (auto i = plural_forms_(n); i; --i) {
+      // Missing forms fall back to the first one, as in libintl.
+      if (form.size() == forms.size()) return first_form(forms);
+      forms.remove_prefix(form.size() + 1);
+      form = first_form(forms);
+    }
+    return form;
+  }
+  static std::string_view first_form(std::string_view forms) {
+    return forms.substr(0, forms.find('\0'));
+  }
+
+  // The key and the complete translation of the entry at index < size(), in the order of the file.
+  std::string_view key(std::uint32_t index) const { return original(index); }
+  std::string_view entry(std::uint32_t index) const {
+    return {translation(index), read(translations + 8 * index)};
+  }
+  // The msgid_plural of the entry at index < size(), or an empty view if it has no plural forms.
+  std::string_view plural(std::uint32_t index) const {
+    std::string_view original(this->original(index), read(originals + 8 * index));
+    auto separator = original.find('\0');
+    return separator == original.npos ? std::string_view() : original.substr(separator + 1);
+  }
+
+  // The header entry, i.e. the translation of the empty msgid.
+  std::string_view header() const {
+    std::string_view header = find("");
+    return header.data() ? header : "";
+  }
+  const PluralForms &plural_forms() const { return plural_forms_; }
+
+ private:
+  static constexpr std::uint32_t magic         = 0x950412de;
+  static constexpr std::uint32_t swapped_magic = 0xde120495;
+  static constexpr std::uint32_t not_found     = -1;
+
+  std::uint32_t read(std::uint32_t offset) const {
+    std::uint32_t value;
+    std::memcpy(&value, data + offset, sizeof value);
+    if (swapped)
+      value = (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+    return value;
+  }
+  const char *original(std::uint32_t index) const {
+    return data + read(originals + 8 * index + 4);
+  }
+  const char *translation(std::uint32_t index) const {
+    return data + read(translations + 8 * index + 4);
+  }
+  // For entries with plural forms the original is "msgid\0msgid_plural", so we only compare up to
+  // the first NUL.
+  bool matches(std::uint32_t index, std::string_view key) const {
+    const char *candidate = original(index);
+    return read(originals + 8 * index) >= key.size()
+           && !std::memcmp(candidate, key.data(), key.size()) && !candidate[key.size()];
+  }
+
+  std::uint32_t lookup(std::string_view key, std::uint32_t hash) const {
+    if (hash_size > 2) {
+      std::uint32_t index     = hash % hash_size;
+      const std::uint32_t inc = 1 + hash % (hash_size - 2);
+      // Tables without empty slots or with a size which is not prime would never end the probing,
+      // they fall back to the binary search.
+      for (std::uint32_t probes = 0; probes != hash_size; ++probes) {
+        std::uint32_t entry = read(hash_table + 4 * index);
+        if (!entry) return not_found;
+        if (--entry < count && matches(entry, key)) return entry;
+        index = index >= hash_size - inc ? index - (hash_size - inc) : index + inc;
+      }
+    }
+    // Files without hash table are sorted, so we can still use a binary search.
+    std::uint32_t low = 0, high = count;
+    while (low < high) {
+      std::uint32_t middle = low + (high - low) / 2;
+      int order            = std::string_view(original(middle)).compare(key);
+      if (order == 0) return middle;
+      if (order < 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    return not_found;
+  }
+
+  void validate() {
+    auto invalid = [] { throw std::runtime_error("Invalid .mo file"); };
+    if (size_ < 28) invalid();
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof value);
+    if (value == swapped_magic)
+      swapped = true;
+    else if (value != magic)
+      invalid();
+    // Only the major revision matters, minor revisions are backwards compatible
+    if (read(4) >> 16) invalid();
+    count        = read(8);
+    originals    = read(12);
+    translations = read(16);
+    hash_size    = read(20);
+    hash_table   = read(24);
+    auto table_fits = [&](std::uint32_t offset, std::uint64_t entries, std::uint64_t entry_size) {
+      return offset % 4 == 0 && offset + entries * entry_size <= size_;
+    };
+    if (!table_fits(originals, count, 8) || !table_fits(translations, count, 8)
+        || (hash_size && !table_fits(hash_table, hash_size, 4)))
+      invalid();
+    // Check all strings once, so that lookups can trust the tables.
+    for (std::uint32_t table : {originals, translations})
+      for (std::uint32_t i = 0; i != count; ++i) {
+        std::uint64_t length = read(table + 8 * i), offset = read(table + 8 * i + 4);
+        if (offset + length >= size_ || data[offset + length]) invalid();
+      }
+  }
+
+#if I18N_HAS_MMAP
+  void map(const std::filesystem::path &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path.string());
+    struct stat info {};
+    void *mapping = MAP_FAILED;
+    if (!::fstat(fd, &info) && info.st_size)
+      mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      if (!info.st_size) throw std::runtime_error("Invalid .mo file");
+      throw std::system_error(error, std::generic_category(), path.string());
+    }
+    data   = static_cast<const char *>(mapping);
+    size_  = info.st_size;
+    mapped = true;
+  }
+  void unmap() {
+    if (mapped) ::munmap(const_cast<char *>(data), size_);
+  }
+#else
+  void map(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::system_error(errno, std::generic_category(), path.string());
+    size_       = std::filesystem::file_size(path);
+    char *owned = new char[size_];
+    if (!file.read(owned, size_)) {
+      delete[] owned;
+      throw std::runtime_error("Unable to read .mo file");
+    }
+    data   = owned;
+    mapped = true;
+  }
+  void unmap() {
+    if (mapped) delete[] data;
+  }
+#endif
+
+  const char *data = nullptr;
+  std::size_t size_;
+  bool swapped = false;
+  // Whether data was mapped or read by map and has to be released by unmap
+  bool mapped = false;
+  std::uint32_t count, originals, translations, hash_size, hash_table;
+  PluralForms plural_forms_;
+};
+
+class CatalogImage;
+
+// The catalogs of all domains for a list of languages. A Locale is immutable after construction,
+// so it can be used by any number of threads without synchronization and copies share the loaded
+// catalogs. Messages can be translated for an explicit locale through msg.in(locale), or a locale
+// can be installed for the current thread with MoBackend::set_thread_locale.
+class Locale {
+ public:
+  using Bindings = std::vector<std::pair<std::string, std::filesystem::path>>;
+
+  // A locale without any catalogs, all messages stay untranslated.
+  Locale() = default;
+  // Loads the catalogs for languages, a colon separated list of locale names in the format used by
+  // the LANGUAGE environment variable. Earlier languages take precedence. Domains are loaded from
+  // the directories in bindings, the default domain from I18N_DEFAULT_LOCALEDIR if it is not bound.
+  // Domains with embedded catalogs (see i18n/embedded.hpp) use them unless they are bound.
+  //
+  // The catalogs of every domain are merged into a single table while loading, so a message which
+  // is only translated by the last language of a long fallback chain is found with one probe.
+  explicit Locale(std::string_view languages, Bindings bindings = {},
+                  std::string default_domain = "messages"):
+      Locale(languages, std::move(bindings), std::move(default_domain), false) {}
+
+  // Loads the locale on a background thread, with the catalogs of different domains loaded in
+  // parallel. The future rethrows the exceptions of the constructor.
+  static std::future<Locale> load_async(std::string languages, Bindings bindings = {},
+                                        std::string default_domain = "messages") {
+    return std::async(std::launch::async, [languages = std::move(languages),
+                                           bindings  = std::move(bindings),
+                                           default_domain = std::move(default_domain)]() mutable {
+      return Locale(languages, std::move(bindings), std::move(default_domain), true);
+    });
+  }
+
+  std::string_view languages() const { return data ? std::string_view(data->languages) : "C"; }
+  std::string_view default_domain() const {
+    return data ? std::string_view(data->default_domain) : "messages";
+  }
+  const Bindings &bindings() const {
+    static const Bindings none;
+    return data ? data->bindings : none;
+  }
+  // The existing LC_MESSAGES directories which were searched for catalogs while loading. Catalogs
+  // which are added to or replaced in them are picked up by reloading the locale.
+  const std::vector<std::filesystem::path> &directories() const {
+    static const std::vector<std::filesystem::path> none;
+    return data ? data->directories : none;
+  }
+  // The system locale used for L format specs in translations, which is built once for the first
+  // of the languages which is installed (see detail::std_locale_for), or nullptr if the global
+  // locale is used because none of them is.
+  const std::locale *format_locale() const {
+    return data && data->format_locale ? &*data->format_locale : nullptr;
+  }
+  // translation, which was returned by this locale, converted to Char. The copy is made once and
+  // freed with the locale.
+  template <typename Char>
+  std::basic_string_view<Char> transcoded(std::string_view translation) const {
+    if (!data) return detail::transcoding_cache<Char>().get(translation);
+    return data->transcoded.get<Char>(translation);
+  }
+  // The translations which were rejected while loading, see I18N_VALIDATE_FORMATS.
+  const std::vector<FormatError> &format_errors() const {
+    static const std::vector<FormatError> none;
+    return data ? data->format_errors : none;
+  }
+
+  // Lookups with the semantics of dgettext and dngettext, see i18n/backend.hpp. The results are
+  // NUL terminated.
+  std::string_view translate(const char *domain, const char *msgid) const {
+    std::string_view key = msgid;
+    return find_translation(domain, key, hash_pjw(key));
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n) const {
+    std::string_view key = msgid;
+    return find_translation(domain, key, plural, n, hash_pjw(key));
+  }
+  std::string_view translate(const char *domain, const char *msgid,
+                             const MessageHash &hash) const {
+    return find_translation(domain, msgid, hash.pjw);
+  }
+  std::string_view translate(const char *domain, const char *msgid, const char *plural,
+                             unsigned long n, const MessageHash &hash) const {
+    return find_translation(domain, msgid, plural, n, hash.pjw);
+  }
+  // Registered messages are resolved when the catalogs are loaded, so they only need a single
+  // indexed load.
+  std::string_view translate(const MessageInfo &info) const {
+    if (!data) return info.key();
+    if (auto index = info.index(); index < data->table.size()) {
+      const Resolved &resolved = data->table[index];
+      return resolved.file ? resolved.singular : info.key();
+    }
+    return find_translation(info.domain, info.key(), info.hash.pjw);
+  }
+  std::string_view translate(const MessageInfo &info, unsigned long n) const {
+    if (!data) return n == 1 ? info.key() : info.plural_view();
+    if (auto index = info.index(); index < data->table.size()) {
+      const Resolved &resolved = data->table[index];
+      if (resolved.file) return resolved.file->plural_form(resolved.translation, n);
+      return n == 1 ? info.key() : info.plural_view();
+    }
+    return find_translation(info.domain, info.key(), info.plural, n, info.hash.pjw);
+  }
+  // Loads the table entry read by translate(info) into the CPU cache.
+  void prefetch(const MessageInfo &info) const {
+    if (data && info.index() < data->table.size())
+      detail::prefetch_address(&data->table[info.index()]);
+  }
+
+  // The locale of the catalog which provides the translation of key in domain, e.g. "de" for a
+  // message which is missing in the de_AT catalog of "de_AT:de", or an empty view if key is not
+  // translated. The name is the one of the catalog's directory.
+  std::string_view origin(const char *domain, std::string_view key) const {
+    if (const Domain *catalogs = find(domain))
+      if (const Entry *entry = catalogs->lookup(key, hash_pjw(key)))
+        return catalogs->catalogs[entry->catalog].locale;
+    return {};
+  }
+  std::string_view origin(const MessageInfo &info) const {
+    if (const Domain *catalogs = find(info.domain))
+      if (const Entry *entry = catalogs->lookup(info.key(), info.hash.pjw))
+        return catalogs->catalogs[entry->catalog].locale;
+    return {};
+  }
+  // Calls visit(key, translation, locale) for every entry of the merged catalogs of domain, where
+  // translation contains all plural forms separated by NUL characters and locale is the origin.
+  template <typename Visit>
+  void for_each_entry(const char *domain, Visit &&visit) const {
+    if (const Domain *catalogs = find(domain))
+      for (const Entry &entry : catalogs->entries)
+        visit(entry.key, entry.translation,
+              std::string_view(catalogs->catalogs[entry.catalog].locale));
+  }
+
+ private:
+  friend class MoBackend;
+  friend class CatalogImage;
+
+  struct Catalog {
+    // The name of the directory the catalog was loaded from, e.g. "de" for the language "de_AT".
+    std::string locale;
+    std::unique_ptr<const MoFile> file;
+  };
+  struct Entry {
+    std::string_view key;
+    // The complete translation including all plural forms
+    std::string_view translation;
+    // Index into Domain::catalogs
+    std::uint32_t catalog;
+  };
+  struct Domain {
+    std::string name;
+    // In the order of the languages
+    std::vector<Catalog> catalogs;
+    // The entries of all catalogs, an entry of an earlier catalog hides the same key in later ones.
+    std::vector<Entry> entries;
+    // Open addressing hash table with linear probing for entries. Every slot holds the hash and one
+    // more than the index of the entry, so mismatches rarely have to compare the keys.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> slots;
+
+    const Entry *lookup(std::string_view key, std::uint32_t hash) const {
+      std::size_t slot = slots.empty() ? 0 : first_slot(hash);
+      for (std::size_t probes = 0; probes != slots.size(); ++probes) {
+        auto [slot_hash, index] = slots[slot];
+        if (!index) return nullptr;
+        if (slot_hash == hash && entries[index - 1].key == key) return &entries[index - 1];
+        slot = (slot + 1) & (slots.size() - 1);
+      }
+      return nullptr;
+    }
+    void merge([[maybe_unused]] std::vector<FormatError> &errors) {
+      std::size_t count = 0;
+      for (auto &catalog : catalogs)
+        count += catalog.file->size();
+      if (!count) return;
+      slots.assign(std::bit_ceil(2 * count), {0, 0});
+      for (std::uint32_t i = 0; i != catalogs.size(); ++i) {
+        const MoFile &file = *catalogs[i].file;
+        for (std::uint32_t j = 0; j != file.size(); ++j) {
+          std::string_view key = file.key(j);
+          std::uint32_t hash   = hash_pjw(key);
+          std::size_t slot     = first_slot(hash);
+          for (; slots[slot].second; slot = (slot + 1) & (slots.size() - 1))
+            if (slots[slot].first == hash && entries[slots[slot].second - 1].key == key) break;
+          if (slots[slot].second) continue;
+#if I18N_VALIDATE_FORMATS
+          // Rejected entries are skipped, so later catalogs can still provide the message.
+          auto context = key.find('\4');
+          auto reason  = check_format_translation(
+              key.substr(context == key.npos ? 0 : context + 1), file.plural(j), file.entry(j));
+          if (!reason.empty()) {
+            errors.push_back(FormatError{name, catalogs[i].locale, std::string(key),
+                                         std::move(reason)});
+            continue;
+          }
+#endif
+          entries.push_back(Entry{key, file.entry(j), i});
+          slots[slot] = {hash, static_cast<std::uint32_t>(entries.size())};
+        }
+      }
+    }
+    // The hashpjw values are poorly distributed, so they are mixed before taking the top bits.
+    std::size_t first_slot(std::uint32_t hash) const {
+      return (hash * 0x9e3779b9u) >> (32 - std::countr_zero(slots.size()));
+    }
+  };
+  struct Resolved {
+    // The complete translation including all plural forms
+    std::string_view translation;
+    // The first form of the translation
+    std::string_view singular;
+    // nullptr if the message is not translated
+    const MoFile *file;
+  };
+  struct Data {
+    std::string languages;
+    std::string default_domain;
+    Bindings bindings;
+    std::vector<Domain> domains;
+    std::vector<std::filesystem::path> directories;
+    std::vector<FormatError> format_errors;
+    std::optional<std::locale> format_locale;
+    // Translations of all registered messages, indexed by MessageInfo::index()
+    std::vector<Resolved> table;
+    // Copies of the translations for literals of other character types
+    detail::TranscodedStrings transcoded;
+
+    void load(bool parallel) {
+      struct Source {
+        std::string name;
+        std::filesystem::path dirname;
+        // Embedded catalogs are used for all domains which are not bound to a directory.
+        bool embedded;
+      };
+      // Every domain is only loaded from the first directory it is bound to.
+      std::vector<Source> sources;
+      auto add_source = [&](std::string name, std::filesystem::path dirname, bool embedded) {
+        for (auto &source : sources)
+          if (source.name == name) return;
+        sources.push_back(Source{std::move(name), std::move(dirname), embedded});
+      };
+      for (auto &binding : bindings)
+        add_source(binding.first, binding.second, false);
+      auto &embedded = detail::embedded_catalog_registry();
+      add_source(default_domain, I18N_DEFAULT_LOCALEDIR, embedded.contains(default_domain));
+      for (auto *catalog : embedded.snapshot())
+        add_source(catalog->domain, {}, true);
+
+      domains.resize(sources.size());
+      std::vector<std::vector<std::filesystem::path>> searched(sources.size());
+      std::vector<std::vector<FormatError>> errors(sources.size());
+      auto load_domain = [&](std::size_t index) {
+        auto &[name, dirname, embedded_only] = sources[index];
+        Domain &domain                       = domains[index];
+        domain.name                          = name;
+        std::string_view remaining           = languages;
+        while (!remaining.empty()) {
+          auto language = remaining.substr(0, remaining.find(':'));
+          remaining.remove_prefix(std::min(remaining.size(), language.size() + 1));
+          if (language.empty() || language == "C" || language == "POSIX") continue;
+          bool found = false;
+          for (auto &variant : variants(language)) {
+            if (embedded_only) {
+              const EmbeddedCatalog *catalog = found ? nullptr : embedded.find(name, variant);
+              if (!catalog) continue;
+              domain.catalogs.push_back(Catalog{
+                  variant,
+                  std::make_unique<const MoFile>(catalog->image.data(), catalog->image.size())});
+              found = true;
+              continue;
+            }
+            auto directory = dirname / variant / "LC_MESSAGES";
+            std::error_code error;
+            if (!std::filesystem::is_directory(directory, error)) continue;
+            searched[index].push_back(directory);
+            auto path = directory / (name + ".mo");
+            if (found || !std::filesystem::is_regular_file(path, error)) continue;
+            domain.catalogs.push_back(Catalog{variant, std::make_unique<const MoFile>(path)});
+            found = true;
+          }
+        }
+        domain.merge(errors[index]);
+      };
+      if (parallel && sources.size() > 1) {
+        std::vector<std::future<void>> tasks;
+        for (std::size_t i = 1; i != sources.size(); ++i)
+          tasks.push_back(std::async(std::launch::async, load_domain, i));
+        load_domain(0);
+        for (auto &task : tasks)
+          task.get();
+      } else {
+        for (std::size_t i = 0; i != sources.size(); ++i)
+          load_domain(i);
+      }
+      for (std::size_t i = 0; i != sources.size(); ++i) {
+        for (auto &directory : searched[i])
+          if (std::find(directories.begin(), directories.end(), directory) == directories.end())
+            directories.push_back(directory);
+        format_errors.insert(format_errors.end(), errors[i].begin(), errors[i].end());
+      }
+
+      auto messages = mfk::i18n::messages();
+      table.assign(messages.size(), Resolved{{}, {}, nullptr});
+      for (std::size_t i = 0; i != messages.size(); ++i)
+        if (const Domain *domain = find(messages[i]->domain))
+          if (const Entry *entry = domain->lookup(messages[i]->key(), messages[i]->hash.pjw))
+            table[i] = Resolved{entry->translation, MoFile::first_form(entry->translation),
+                                domain->catalogs[entry->catalog].file.get()};
+    }
+
+    const Domain *find(const char *name) const {
+      const std::string_view wanted =
+          name ? std::string_view(name) : std::string_view(default_domain);
+      for (auto &domain : domains)
+        if (domain.name == wanted) return &domain;
+      return nullptr;
+    }
+  };
+
+  Locale(std::string_view languages, Bindings bindings, std::string default_domain,
+         bool parallel) {
+    auto data            = std::make_shared<Data>();
+    data->languages      = languages;
+    data->bindings       = std::move(bindings);
+    data->default_domain = std::move(default_domain);
+    data->format_locale  = detail::std_locale_for(data->languages);
+    data->load(parallel);
+    this->data = std::move(data);
+  }
+
+  const Domain *find(const char *name) const { return data ? data->find(name) : nullptr; }
+
+  std::string_view find_translation(const char *domain, std::string_view key,
+                                    std::uint32_t hash) const {
+    if (const Domain *catalogs = find(domain))
+      if (const Entry *entry = catalogs->lookup(key, hash))
+        return MoFile::first_form(entry->translation);
+    return key;
+  }
+  std::string_view find_translation(const char *domain, std::string_view key, const char *plural,
+                                    unsigned long n, std::uint32_t hash) const {
+    if (const Domain *catalogs = find(domain))
+      if (const Entry *entry = catalogs->lookup(key, hash))
+        return catalogs->catalogs[entry->catalog].file->plural_form(entry->translation, n);
+    return n == 1 ? key : plural;
+  }
+
+  // Locale name variants in the order libintl tries them, e.g. for "de_DE.UTF-8@euro":
+  // de_DE.UTF-8@euro, de_DE@euro, de.UTF-8@euro, de@euro, de_DE.UTF-8, de_DE, de.UTF-8, de
+  static std::vector<std::string> variants(std::string_view name) {
+    auto modifier_pos  = name.find('@');
+    auto modifier      = modifier_pos == name.npos ? "" : name.substr(modifier_pos);
+    name               = name.substr(0, modifier_pos);
+    auto codeset_pos   = name.find('.');
+    auto codeset       = codeset_pos == name.npos ? "" : name.substr(codeset_pos);
+    name               = name.substr(0, codeset_pos);
+    auto territory_pos = name.find('_');
+    auto territory     = territory_pos == name.npos ? "" : name.substr(territory_pos);
+    name               = name.substr(0, territory_pos);
+
+    std::vector<std::string> result;
+    for (int mask = 7; mask >= 0; --mask) {
+      if (((mask & 4) && modifier.empty()) || ((mask & 2) && territory.empty())
+          || ((mask & 1) && codeset.empty()))
+        continue;
+      std::string variant(name);
+      if (mask & 2) variant += territory;
+      if (mask & 1) variant += codeset;
+      if (mask & 4) variant += modifier;
+      result.push_back(std::move(variant));
+    }
+    return result;
+  }
+
+  std::shared_ptr<const Data> data;
+};
+
+// A backend reading .mo files directly instead of going through libintl. It uses the process wide
+// Locale configured through set_language, textdomain and bindtextdomain, unless a different locale
+// has been installed for the current thread. All catalogs are loaded when the configuration
+// changes, so lookups neither take locks nor consult the environment or the C locale.
+//
+// Only domains which were either bound with bindtextdomain, selected with textdomain or embedded
+// into the program are translated.
+class MoBackend {
+ public:
+  // All lookups are forwarded to locale().
+  template <typename... Args>
+  static std::string_view translate(const Args &...args) {
+    return locale().translate(args...);
+  }
+  static void prefetch(const MessageInfo &info) { locale().prefetch(info); }
+
+  // The locale used by the calling thread.
+  static const Locale &locale() {
+    if (thread_locale) return *thread_locale;
+    const Locale *global = current.load(std::memory_order_acquire);
+    return global ? *global : untranslated;
+  }
+  // Used for L format specs in the translations of the calling thread, see Locale::format_locale.
+  static const std::locale *format_locale() { return locale().format_locale(); }
+  template <typename Char>
+  static std::basic_string_view<Char> transcoded(std::string_view translation) {
+    return locale().transcoded<Char>(translation);
+  }
+  // Loads a locale for languages using the current bindings and default domain.
+  static Locale locale(std::string_view languages) {
+    const Locale &global = global_locale();
+    return Locale(languages, global.bindings(), std::string(global.default_domain()));
+  }
+  // Same as locale(languages), but loads the catalogs on a background thread, see
+  // Locale::load_async.
+  static std::future<Locale> locale_async(std::string_view languages) {
+    const Locale &global = global_locale();
+    return Locale::load_async(std::string(languages), global.bindings(),
+                              std::string(global.default_domain()));
+  }
+  // Installs a locale for the current thread, or restores the process wide locale if locale is
+  // empty. Returns the previously installed locale.
+  static std::optional<Locale> set_thread_locale(std::optional<Locale> locale) {
+    std::optional<Locale> previous = std::exchange(thread_locale, std::move(locale));
+    detail::invalidate_thread_translations();
+    return previous;
+  }
+
+  // Sets the languages to use, as a colon separated list of locale names in the format used by the
+  // LANGUAGE environment variable. Earlier languages take precedence.
+  static void set_language(std::string_view languages) {
+    update([&](Config &config) { config.languages = languages; });
+  }
+  // Determines the language from the environment, the same way libintl does for LC_MESSAGES.
+  static void set_language() {
+    for (const char *variable : {"LC_ALL", "LC_MESSAGES", "LANG"})
+      if (const char *value = std::getenv(variable); value && *value) {
+        const char *list = std::getenv("LANGUAGE");
+        if (std::strcmp(value, "C") && std::strcmp(value, "POSIX") && list && *list)
+          return set_language(list);
+        return set_language(value);
+      }
+    set_language("C");
+  }
+  // Same as set_language, but returns immediately and loads the catalogs on background threads.
+  // Until they are loaded, lookups keep using the previous locale, so messages stay untranslated
+  // instead of blocking. Later changes of the configuration include the new languages, and the
+  // locale is not installed anymore if a later change has been installed before it finished.
+  // The future rethrows the exceptions of loading, in which case the previous locale stays in use.
+  static std::shared_future<void> set_language_async(std::string_view languages) {
+    return update_async([&](Config &config) { config.languages = languages; });
+  }
+  static void textdomain(std::string_view domain) {
+    update([&](Config &config) { config.default_domain = domain; });
+  }
+  static void bindtextdomain(std::string_view domain, std::filesystem::path dirname) {
+    update([&](Config &config) {
+      auto binding = config.bindings.begin();
+      while (binding != config.bindings.end() && binding->first != domain)
+        ++binding;
+      if (binding != config.bindings.end())
+        binding->second = std::move(dirname);
+      else
+        config.bindings.emplace_back(domain, std::move(dirname));
+    });
+  }
+  // Loads all catalogs of the process wide locale again, e.g. after .mo files have been replaced.
+  // Catalogs should be replaced by renaming new files over them, since the old files stay mapped
+  // into memory. Locales returned by locale(languages) are not affected. See also CatalogWatcher
+  // in i18n/reload.hpp.
+  static void reload() {
+    update([](Config &) {});
+  }
+
+  // Same as reload, but returns immediately like set_language_async.
+  static std::shared_future<void> reload_async() {
+    return update_async([](Config &) {});
+  }
+
+  // Lookups don't take locks, so other threads might still use a locale after it has been
+  // replaced, and translations returned before stay valid as long as their locale is alive.
+  // Replaced locales are therefore kept for period before they are freed, and translations of the
+  // process wide locale must not be used longer than that after a change of the configuration.
+  // Keep a copy of locale() to hold on to translations longer. Locales are freed by the first
+  // change after their period ended. A period of duration::max() never frees them.
+  static constexpr std::chrono::minutes default_grace_period{5};
+  static void set_grace_period(std::chrono::steady_clock::duration period) {
+    std::lock_guard lock(mutex);
+    grace_period = period;
+    reclaim(std::chrono::steady_clock::now());
+  }
+
+ private:
+  static const Locale &global_locale() {
+    const Locale *global = current.load(std::memory_order_acquire);
+    return global ? *global : untranslated;
+  }
+
+  // The configuration of the process wide locale.
+  struct Config {
+    std::string languages;
+    Locale::Bindings bindings;
+    std::string default_domain;
+  };
+
+  // Applies change to the configuration requested last and numbers the request. The requested
+  // configuration accumulates all changes, even if their locales are still loading.
+  template <typename Change>
+  static std::pair<Config, std::uint64_t> request(Change &&change) {
+    std::lock_guard lock(mutex);
+    if (!requested) {
+      const Locale &old = global_locale();
+      requested = Config{std::string(old.languages()), old.bindings(),
+                         std::string(old.default_domain())};
+    }
+    change(*requested);
+    return {*requested, ++requests};
+  }
+  // Loads the locale for a request without holding the lock and installs it unless a later request
+  // has been installed already, so the last request wins regardless of the order in which loading
+  // finishes.
+  static void load(const Config &config, std::uint64_t request, bool parallel) {
+    std::unique_ptr<const Locale> locale;
+    try {
+      locale = std::make_unique<const Locale>(Locale(config.languages, config.bindings,
+                                                     config.default_domain, parallel));
+    } catch (...) {
+      // Later requests start from the installed configuration again.
+      std::lock_guard lock(mutex);
+      if (request == requests) requested.reset();
+      throw;
+    }
+    std::lock_guard lock(mutex);
+    if (request < installed) return;
+    installed = request;
+    current.store(locale.get(), std::memory_order_release);
+    // Readers don't take any locks, so they might still use the old locale. Therefore replaced
+    // locales are kept alive for the grace period.
+    auto now = std::chrono::steady_clock::now();
+    if (owned) retired.emplace_back(std::move(owned), now);
+    owned = std::move(locale);
+    invalidate_translations();
+    reclaim(now);
+  }
+  template <typename Change>
+  static void update(Change &&change) {
+    auto [config, number] = request(std::forward<Change>(change));
+    load(config, number, false);
+  }
+  // Same as update, but loads on a background thread. The request is numbered by the calling
+  // thread, so requests are ordered as they were made. The futures of unfinished updates are
+  // kept, so that the program waits for them when it exits even if the caller discards its copy.
+  template <typename Change>
+  static std::shared_future<void> update_async(Change &&change) {
+    auto [config, number]           = request(std::forward<Change>(change));
+    std::shared_future<void> result = std::async(std::launch::async, [config, number] {
+                                        load(config, number, true);
+                                      }).share();
+    std::lock_guard lock(pending_mutex);
+    std::erase_if(pending, [](const std::shared_future<void> &update) {
+      return update.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+    pending.push_back(result);
+    return result;
+  }
+  static void reclaim(std::chrono::steady_clock::time_point now) {
+    std::erase_if(retired, [&](const auto &locale) { return now - locale.second >= grace_period; });
+  }
+
+  static inline const Locale untranslated;
+  static inline std::mutex mutex;
+  static inline std::unique_ptr<const Locale> owned;
+  static inline std::optional<Config> requested;
+  // The number of the last request and of the request whose locale is installed
+  static inline std::uint64_t requests = 0, installed = 0;
+  // Replaced locales with the time they were replaced
+  static inline std::vector<std::pair<std::unique_ptr<const Locale>,
+                                      std::chrono::steady_clock::time_point>> retired;
+  static inline std::chrono::steady_clock::duration grace_period = default_grace_period;
+  static inline std::atomic<const Locale *> current{nullptr};
+  static inline thread_local std::optional<Locale> thread_locale;
+  // Declared last, so that unfinished updates are waited for before the other members are
+  // destroyed.
+  static inline std::mutex pending_mutex;
+  static inline std::vector<std::shared_future<void>> pending;
+};
+
+} // namespace mfk::i18n
+
+#endif
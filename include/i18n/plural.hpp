@@ -0,0 +1,488 @@
+#ifndef I18N_PLURAL_HPP
+#define I18N_PLURAL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mfk::i18n {
+
+// The plural selection rule of a catalog as described by the expression in its Plural-Forms header.
+// The expression is parsed once and can then be evaluated for arbitrary n.
+class PluralForms {
+ public:
+  // Defaults to the germanic plural rule "nplurals=2; plural=(n != 1);" which libintl uses when a
+  // catalog does not provide a Plural-Forms header.
+  PluralForms() : PluralForms("nplurals=2; plural=(n != 1);") {}
+
+  // Parses the value of a Plural-Forms header, e.g. "nplurals=2; plural=(n != 1);".
+  // Throws std::invalid_argument if the value is malformed.
+  explicit PluralForms(std::string_view value) {
+    // "plural=" can not match inside of "nplurals=", so the order does not matter.
+    auto nplurals_pos = value.find("nplurals=");
+    auto plural_pos   = value.find("plural=");
+    if (nplurals_pos == std::string_view::npos || plural_pos == std::string_view::npos)
+      throw std::invalid_argument("Plural-Forms requires nplurals and plural");
+
+    // libintl allows whitespace in front of the number
+    std::string_view count = value.substr(nplurals_pos + 9);
+    count.remove_prefix(std::min(count.find_first_not_of(" \t"), count.size()));
+    std::size_t i = 0;
+    for (count_ = 0; i != count.size() && count[i] >= '0' && count[i] <= '9'; ++i)
+      count_ = count_ * 10 + (count[i] - '0');
+    if (!i || !count_) throw std::invalid_argument("Plural-Forms: invalid nplurals");
+
+    std::string_view expression = value.substr(plural_pos + 7);
+    expression                  = expression.substr(0, expression.find_first_of(";\n"));
+    std::vector<Node> nodes;
+    Parser parser{expression, nodes};
+    auto root = parser.parse();
+    code_.clear();
+    std::size_t depth = 0;
+    compile(nodes, root, depth);
+    fill_table();
+  }
+
+  // Extracts the Plural-Forms header from the header entry (the translation of "") of a catalog.
+  // Falls back to the default rule if no such header exists.
+  static PluralForms from_header(std::string_view header) {
+    for (std::size_t pos = 0; pos < header.size();) {
+      auto end  = header.find('\n', pos);
+      auto line = header.substr(pos, end == std::string_view::npos ? end : end - pos);
+      if (line.starts_with("Plural-Forms:")) return PluralForms(line.substr(13));
+      if (end == std::string_view::npos) break;
+      pos = end + 1;
+    }
+    return {};
+  }
+  // Same as from_header, but also falls back to the default rule if the header is malformed, as
+  // libintl does when loading a catalog.
+  static PluralForms from_header_or_default(std::string_view header) {
+    try {
+      return from_header(header);
+    } catch (const std::invalid_argument &) {
+      return {};
+    }
+  }
+
+  // The compiled expression and nplurals in a portable binary form, e.g. for storing it in a
+  // compiled catalog instead of the Plural-Forms header. Every instruction is stored as a
+  // little-endian 32 bit opcode followed by its 64 bit argument.
+  std::string bytecode() const {
+    std::string result;
+    auto put = [&](std::uint64_t value, int bytes) {
+      for (int i = 0; i != bytes; ++i)
+        result += static_cast<char>(value >> 8 * i);
+    };
+    put(count_, 4);
+    for (const Instruction &instruction : code_) {
+      put(static_cast<std::uint32_t>(instruction.code), 4);
+      put(instruction.argument, 8);
+    }
+    return result;
+  }
+  // Loads the result of bytecode(). The code is checked, so it is safe to load untrusted input.
+  // Throws std::invalid_argument if it is malformed.
+  static PluralForms from_bytecode(std::string_view bytecode) {
+    auto invalid = [] { throw std::invalid_argument("Plural-Forms: invalid plural bytecode"); };
+    auto get     = [&](std::size_t offset, int bytes) {
+      std::uint64_t value = 0;
+      for (int i = 0; i != bytes; ++i)
+        value |= std::uint64_t(static_cast<unsigned char>(bytecode[offset + i])) << 8 * i;
+      return value;
+    };
+    if (bytecode.size() < 4 || (bytecode.size() - 4) % 12) invalid();
+    PluralForms result;
+    result.count_ = get(0, 4);
+    result.code_.clear();
+    for (std::size_t offset = 4; offset != bytecode.size(); offset += 12) {
+      auto code = get(offset, 4);
+      if (code > static_cast<std::uint32_t>(Code::Jump)) invalid();
+      result.code_.push_back(Instruction{static_cast<Code>(code), get(offset + 4, 8)});
+    }
+    if (!result.count_ || !result.verify()) invalid();
+    result.fill_table();
+    return result;
+  }
+
+  unsigned long nplurals() const { return count_; }
+
+  // Returns the index of the plural form to be used for n. Out of range results get mapped to 0,
+  // which mirrors libintl's behavior.
+  unsigned long operator()(unsigned long n) const {
+    if (n < table_.size() && table_[n] != no_entry) return table_[n];
+    unsigned long index = evaluate(n);
+    return index < count_ ? index : 0;
+  }
+
+ private:
+  enum class Op : std::uint8_t {
+    Number,
+    Variable,
+    Not,
+    Multiply,
+    Divide,
+    Modulo,
+    Plus,
+    Minus,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+    Conditional,
+  };
+  struct Node {
+    Op op;
+    unsigned long value = 0;
+    std::uint32_t operands[3]{};
+  };
+
+  // Recursive descent parser for the C subset used in Plural-Forms expressions.
+  struct Parser {
+    std::string_view input;
+    std::vector<Node> &nodes;
+    std::size_t pos   = 0;
+    std::size_t depth = 0;
+
+    // Limits the recursion for untrusted headers like "plural=((((...". Compiling recurses into
+    // long chains like "n+n+...+n", so the number of nodes is limited too.
+    struct Nested {
+      explicit Nested(Parser &parser): parser(parser) {
+        if (++parser.depth > max_depth) too_deep();
+      }
+      ~Nested() { --parser.depth; }
+      Parser &parser;
+    };
+
+    std::uint32_t parse() {
+      auto root = conditional();
+      skip_space();
+      if (pos != input.size()) fail();
+      return root;
+    }
+
+    [[noreturn]] static void fail() {
+      throw std::invalid_argument("Plural-Forms: invalid plural expression");
+    }
+    [[noreturn]] static void too_deep() {
+      throw std::invalid_argument("Plural-Forms: plural expression is nested too deeply");
+    }
+    void skip_space() {
+      while (pos != input.size() && (input[pos] == ' ' || input[pos] == '\t'))
+        ++pos;
+    }
+    bool accept(std::string_view token) {
+      skip_space();
+      if (!input.substr(pos).starts_with(token)) return false;
+      pos += token.size();
+      return true;
+    }
+    std::uint32_t add(Op op, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0) {
+      if (nodes.size() == max_nodes) too_deep();
+      nodes.push_back(Node{op, 0, {a, b, c}});
+      return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    std::uint32_t conditional() {
+      Nested nested(*this);
+      auto condition = logical_or();
+      if (!accept("?")) return condition;
+      auto then = conditional();
+      if (!accept(":")) fail();
+      auto otherwise = conditional();
+      return add(Op::Conditional, condition, then, otherwise);
+    }
+    std::uint32_t logical_or() {
+      auto left = logical_and();
+      while (accept("||"))
+        left = add(Op::Or, left, logical_and());
+      return left;
+    }
+    std::uint32_t logical_and() {
+      auto left = equality();
+      while (accept("&&"))
+        left = add(Op::And, left, equality());
+      return left;
+    }
+    std::uint32_t equality() {
+      auto left = relational();
+      while (true) {
+        if (accept("=="))
+          left = add(Op::Equal, left, relational());
+        else if (accept("!="))
+          left = add(Op::NotEqual, left, relational());
+        else
+          return left;
+      }
+    }
+    std::uint32_t relational() {
+      auto left = additive();
+      while (true) {
+        if (accept("<="))
+          left = add(Op::LessEqual, left, additive());
+        else if (accept(">="))
+          left = add(Op::GreaterEqual, left, additive());
+        else if (accept("<"))
+          left = add(Op::Less, left, additive());
+        else if (accept(">"))
+          left = add(Op::Greater, left, additive());
+        else
+          return left;
+      }
+    }
+    std::uint32_t additive() {
+      auto left = multiplicative();
+      while (true) {
+        if (accept("+"))
+          left = add(Op::Plus, left, multiplicative());
+        else if (accept("-"))
+          left = add(Op::Minus, left, multiplicative());
+        else
+          return left;
+      }
+    }
+    std::uint32_t multiplicative() {
+      auto left = unary();
+      while (true) {
+        if (accept("*"))
+          left = add(Op::Multiply, left, unary());
+        else if (accept("/"))
+          left = add(Op::Divide, left, unary());
+        else if (accept("%"))
+          left = add(Op::Modulo, left, unary());
+        else
+          return left;
+      }
+    }
+    std::uint32_t unary() {
+      // Make sure that "!=" is never parsed as a negation
+      skip_space();
+      if (pos + 1 < input.size() && input[pos] == '!' && input[pos + 1] != '=') {
+        Nested nested(*this);
+        ++pos;
+        return add(Op::Not, unary());
+      }
+      return primary();
+    }
+    std::uint32_t primary() {
+      if (accept("(")) {
+        auto inner = conditional();
+        if (!accept(")")) fail();
+        return inner;
+      }
+      if (accept("n")) return add(Op::Variable);
+      skip_space();
+      if (pos == input.size() || input[pos] < '0' || input[pos] > '9') fail();
+      unsigned long value = 0;
+      for (; pos != input.size() && input[pos] >= '0' && input[pos] <= '9'; ++pos)
+        value = value * 10 + (input[pos] - '0');
+      auto node         = add(Op::Number);
+      nodes[node].value = value;
+      return node;
+    }
+  };
+
+  // The expression is compiled into code for a small stack machine. Logical operators and
+  // conditionals become jumps, so only the branches which are actually taken get evaluated.
+  enum class Code : std::uint8_t {
+    Push,
+    Load,
+    Not,
+    Multiply,
+    Divide,
+    Modulo,
+    Plus,
+    Minus,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    // Pops the top of the stack and jumps to argument if it is zero
+    JumpIfZero,
+    Jump,
+  };
+  struct Instruction {
+    Code code;
+    unsigned long argument = 0;
+  };
+  // Real world expressions need less than ten stack entries
+  static constexpr std::size_t max_depth = 64;
+  static constexpr std::size_t max_nodes = 1024;
+  // Marks n for which the result does not fit into the table
+  static constexpr std::uint8_t no_entry = 255;
+
+  void emit(Code code, unsigned long argument = 0) { code_.push_back(Instruction{code, argument}); }
+  // Appends the code for nodes[index]. depth is the stack depth before the code gets executed.
+  void compile(const std::vector<Node> &nodes, std::uint32_t index, std::size_t depth) {
+    if (depth + 1 > max_depth) Parser::too_deep();
+    const Node &node = nodes[index];
+    // Emits a jump and returns its position so that the target can be set later
+    auto jump = [&](Code code) {
+      emit(code);
+      return code_.size() - 1;
+    };
+    auto land = [&](std::size_t jump) { code_[jump].argument = code_.size(); };
+    switch (node.op) {
+    case Op::Number: emit(Code::Push, node.value); return;
+    case Op::Variable: emit(Code::Load); return;
+    case Op::Not:
+      compile(nodes, node.operands[0], depth);
+      emit(Code::Not);
+      return;
+    case Op::And: {
+      // a && b  =>  a ? !!b : 0
+      compile(nodes, node.operands[0], depth);
+      auto to_false = jump(Code::JumpIfZero);
+      compile(nodes, node.operands[1], depth);
+      emit(Code::Not);
+      emit(Code::Not);
+      auto to_end = jump(Code::Jump);
+      land(to_false);
+      emit(Code::Push, 0);
+      land(to_end);
+      return;
+    }
+    case Op::Or: {
+      // a || b  =>  a ? 1 : !!b
+      compile(nodes, node.operands[0], depth);
+      auto to_second = jump(Code::JumpIfZero);
+      emit(Code::Push, 1);
+      auto to_end = jump(Code::Jump);
+      land(to_second);
+      compile(nodes, node.operands[1], depth);
+      emit(Code::Not);
+      emit(Code::Not);
+      land(to_end);
+      return;
+    }
+    case Op::Conditional: {
+      compile(nodes, node.operands[0], depth);
+      auto to_otherwise = jump(Code::JumpIfZero);
+      compile(nodes, node.operands[1], depth);
+      auto to_end = jump(Code::Jump);
+      land(to_otherwise);
+      compile(nodes, node.operands[2], depth);
+      land(to_end);
+      return;
+    }
+    default: break;
+    }
+    // All remaining operations are binary and map directly to an instruction
+    compile(nodes, node.operands[0], depth);
+    compile(nodes, node.operands[1], depth + 1);
+    emit(static_cast<Code>(static_cast<int>(Code::Multiply) + static_cast<int>(node.op)
+                           - static_cast<int>(Op::Multiply)));
+  }
+  static_assert(int(Code::NotEqual) - int(Code::Multiply) == int(Op::NotEqual) - int(Op::Multiply));
+
+  unsigned long evaluate(unsigned long n) const {
+    unsigned long stack[max_depth];
+    std::size_t top = 0;
+    for (std::size_t pc = 0; pc != code_.size(); ++pc) {
+      const Instruction &instruction = code_[pc];
+      if (instruction.code == Code::Push) {
+        stack[top++] = instruction.argument;
+        continue;
+      }
+      if (instruction.code == Code::Load) {
+        stack[top++] = n;
+        continue;
+      }
+      if (instruction.code == Code::Jump) {
+        pc = instruction.argument - 1;
+        continue;
+      }
+      if (instruction.code == Code::JumpIfZero) {
+        if (!stack[--top]) pc = instruction.argument - 1;
+        continue;
+      }
+      if (instruction.code == Code::Not) {
+        stack[top - 1] = !stack[top - 1];
+        continue;
+      }
+      unsigned long right = stack[--top];
+      unsigned long &left = stack[top - 1];
+      switch (instruction.code) {
+      case Code::Multiply: left = left * right; break;
+      case Code::Divide: left = right ? left / right : 0; break;
+      case Code::Modulo: left = right ? left % right : 0; break;
+      case Code::Plus: left = left + right; break;
+      case Code::Minus: left = left - right; break;
+      case Code::Less: left = left < right; break;
+      case Code::Greater: left = left > right; break;
+      case Code::LessEqual: left = left <= right; break;
+      case Code::GreaterEqual: left = left >= right; break;
+      case Code::Equal: left = left == right; break;
+      case Code::NotEqual: left = left != right; break;
+      default: break;
+      }
+    }
+    return top ? stack[top - 1] : 0;
+  }
+
+  // Checks that code loaded by from_bytecode can be evaluated safely: The compiler only emits
+  // forward jumps and every instruction is always reached with the same stack depth, which has to
+  // stay within max_depth. The result is the only value left on the stack.
+  bool verify() const {
+    std::vector<std::size_t> depths(code_.size() + 1, std::size_t(-1));
+    depths[0] = 0;
+    // Records that target is reached with depth
+    auto reach = [&](unsigned long target, std::size_t depth) {
+      if (target >= depths.size()) return false;
+      if (depths[target] == std::size_t(-1)) depths[target] = depth;
+      return depths[target] == depth;
+    };
+    for (std::size_t pc = 0; pc != code_.size(); ++pc) {
+      std::size_t depth              = depths[pc];
+      const Instruction &instruction = code_[pc];
+      if (depth == std::size_t(-1)) return false;
+      switch (instruction.code) {
+      case Code::Push:
+      case Code::Load:
+        if (depth == max_depth || !reach(pc + 1, depth + 1)) return false;
+        break;
+      case Code::Not:
+        if (!depth || !reach(pc + 1, depth)) return false;
+        break;
+      case Code::JumpIfZero:
+        if (!depth || instruction.argument <= pc || !reach(instruction.argument, depth - 1)
+            || !reach(pc + 1, depth - 1))
+          return false;
+        break;
+      case Code::Jump:
+        if (instruction.argument <= pc || !reach(instruction.argument, depth)) return false;
+        break;
+      default:
+        if (depth < 2 || !reach(pc + 1, depth - 1)) return false;
+      }
+    }
+    return depths.back() == 1;
+  }
+
+  // Small numbers are by far the most common, so their results are computed in advance.
+  void fill_table() {
+    for (unsigned long n = 0; n != table_.size(); ++n) {
+      unsigned long index = evaluate(n);
+      index               = index < count_ ? index : 0;
+      table_[n]           = index < no_entry ? static_cast<std::uint8_t>(index) : no_entry;
+    }
+  }
+
+  unsigned long count_ = 2;
+  std::vector<Instruction> code_;
+  std::array<std::uint8_t, 256> table_;
+};
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef I18N_PREWARM_HPP
+#define I18N_PREWARM_HPP
+
+#include "backend.hpp"
+#include "cache.hpp"
+#include "registry.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace mfk::i18n {
+
+struct PrewarmResult {
+  std::chrono::steady_clock::duration duration{};
+  // Number of messages of the domain which are used by the program
+  std::size_t messages = 0;
+  // Number of those messages without a translation
+  std::size_t untranslated = 0;
+};
+
+// Looks up every registered message of domain in catalog, so that the catalogs get loaded before
+// they are needed. A domain of nullptr refers to all messages which use the default domain.
+// catalog can be an object like a Locale or a stateless backend like GettextBackend{}.
+//
+// For stateless backends with I18N_CACHE_TRANSLATIONS, the translations are also stored in the
+// translation cache, which is per thread, so every thread which should start with a warm cache has
+// to call this itself. The cache is keyed by n, so messages with plural forms are only cached for
+// n == 1.
+template <typename Catalog>
+PrewarmResult prewarm(const char *domain, const Catalog &catalog) {
+  PrewarmResult result;
+  auto start = std::chrono::steady_clock::now();
+  for (const MessageInfo *info : messages()) {
+    if (domain ? !info->domain || std::strcmp(domain, info->domain) : info->domain != nullptr)
+      continue;
+    ++result.messages;
+    // Falls back to the singular like I18NStringImpl::translate, so that the cached values match.
+    auto lookup = [&]() -> std::string_view {
+      std::string_view translated =
+          info->plural
+              ? detail::translate(catalog, info->domain, info->msgid, info->plural, 1, info)
+              : detail::translate(catalog, info->domain, info->msgid, info);
+      return translated.data() != info->msgid ? translated : info->singular_view();
+    };
+    std::string_view translated;
+    // Only stateless backends are used with the cache, see I18NStringImpl::translate.
+    if constexpr (!std::is_empty_v<Catalog>)
+      translated = lookup();
+    else if (info->plural)
+      translated = detail::cached_translation(info->domain, info->msgid, 1, lookup);
+    else
+      translated = detail::cached_translation(info->domain, info->msgid, lookup);
+    result.untranslated += translated.data() == info->singular;
+  }
+  result.duration = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+// Prewarms domain for the backend used by the string classes.
+template <typename Backend = I18N_BACKEND>
+PrewarmResult prewarm(const char *domain) {
+  return prewarm(domain, Backend{});
+}
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef I18N_REGISTRY_HPP
+#define I18N_REGISTRY_HPP
+
+#include "hash.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mfk::i18n {
+
+// Describes a message known at compile time. Every CompileTimeI18NString which is used in the
+// program registers such a description during static initialization and gets a dense index.
+struct MessageInfo {
+  const char *domain;
+  // "msgctxt\4msgid\0msgid_plural", the context and plural parts are optional.
+  const char *msgid;
+  const char *singular;
+  const char *plural;
+  // Lengths of the lookup key, i.e. of msgid without the plural part, of singular and of plural.
+  std::size_t key_length, singular_length, plural_length;
+  MessageHash hash;
+  // 0 as long as the message hasn't been registered yet, otherwise one more than the index.
+  std::uint32_t *registration;
+
+  // Returns std::uint32_t(-1) if the message isn't registered yet.
+  std::uint32_t index() const { return *registration - 1; }
+
+  constexpr std::string_view key() const { return {msgid, key_length}; }
+  constexpr std::string_view singular_view() const { return {singular, singular_length}; }
+  constexpr std::string_view plural_view() const { return {plural, plural_length}; }
+};
+
+namespace detail {
+// Entries are stored in chunks of growing size which are never moved, so get() can read them
+// without taking the lock. Chunk k holds the indices [min_chunk * (2^k - 1), min_chunk *
+// (2^(k+1) - 1)), which covers all 32 bit indices with 25 chunks.
+class MessageRegistry {
+ public:
+  MessageRegistry() = default;
+  MessageRegistry(const MessageRegistry &) = delete;
+  MessageRegistry &operator=(const MessageRegistry &) = delete;
+  ~MessageRegistry() {
+    for (auto &chunk : chunks)
+      delete[] chunk.load(std::memory_order_relaxed);
+  }
+
+  // Registers info unless it is registered already and returns one more than its index.
+  std::uint32_t add(const MessageInfo *info) {
+    std::lock_guard lock(mutex);
+    if (*info->registration) return *info->registration;
+    std::uint32_t index = count.load(std::memory_order_relaxed);
+    auto [chunk, offset] = locate(index);
+    const MessageInfo **entries = chunks[chunk].load(std::memory_order_relaxed);
+    if (!entries) {
+      entries = new const MessageInfo *[min_chunk << chunk];
+      chunks[chunk].store(entries, std::memory_order_relaxed);
+    }
+    entries[offset] = info;
+    count.store(index + 1, std::memory_order_release);
+    return *info->registration = index + 1;
+  }
+  // Returns nullptr for indices which aren't registered.
+  const MessageInfo *get(std::uint32_t index) const {
+    if (index >= count.load(std::memory_order_acquire)) return nullptr;
+    auto [chunk, offset] = locate(index);
+    return chunks[chunk].load(std::memory_order_relaxed)[offset];
+  }
+  std::vector<const MessageInfo *> snapshot() const {
+    std::uint32_t size = count.load(std::memory_order_acquire);
+    std::vector<const MessageInfo *> messages;
+    messages.reserve(size);
+    for (std::uint32_t i = 0; i != size; ++i)
+      messages.push_back(get(i));
+    return messages;
+  }
+
+ private:
+  static constexpr std::uint32_t min_chunk = 256;
+
+  static std::pair<std::size_t, std::uint32_t> locate(std::uint32_t index) {
+    std::size_t chunk = std::bit_width(index / min_chunk + 1) - 1;
+    return {chunk, index - min_chunk * ((std::uint32_t(1) << chunk) - 1)};
+  }
+
+  std::mutex mutex;
+  std::atomic<std::uint32_t> count = 0;
+  std::atomic<const MessageInfo **> chunks[25] = {};
+};
+
+// A function local static makes sure that the registry is initialized before the first message
+// registers itself.
+inline MessageRegistry &message_registry() {
+  static MessageRegistry registry;
+  return registry;
+}
+
+inline std::uint32_t register_message(const MessageInfo *info) {
+  return message_registry().add(info);
+}
+// The index of a message, which is registered now if that hasn't happened yet. Literals register
+// themselves during static initialization, but in unspecified order, so e.g. handles in static
+// tables of other translation units can be created first.
+inline std::uint32_t registered_index(const MessageInfo &info) {
+  std::uint32_t index = info.index();
+  return index != std::uint32_t(-1) ? index : register_message(&info) - 1;
+}
+
+// Registry entries for messages which are only known at runtime, see MessageHandle::intern. Every
+// distinct message is registered once and its strings are kept until the program ends.
+class InternedMessages {
+ public:
+  // msgid is "msgctxt\4msgid" without the plural, plural is nullptr for messages without plural.
+  const MessageInfo &get(const char *domain, std::string_view msgid, const char *singular,
+                         const char *plural) {
+    std::string key;
+    key.append(domain ? domain : "").append(1, domain ? '\1' : '\0').append(msgid);
+    key.append(1, '\0').append(singular);
+    if (plural) key.append(1, '\0').append(plural);
+
+    std::lock_guard lock(mutex);
+    auto [iter, inserted] = messages.try_emplace(std::move(key));
+    Message &message      = iter->second;
+    if (inserted) {
+      message.domain   = domain ? domain : "";
+      message.id       = msgid;
+      message.singular = singular;
+      if (plural) message.id.append(1, '\0').append(plural);
+      message.info = MessageInfo{domain ? message.domain.c_str() : nullptr,
+                                 message.id.c_str(),
+                                 message.singular.c_str(),
+                                 plural ? message.id.c_str() + msgid.size() + 1 : nullptr,
+                                 msgid.size(),
+                                 message.singular.size(),
+                                 plural ? message.id.size() - msgid.size() - 1 : 0,
+                                 hash_message(msgid),
+                                 &message.registration};
+      message.registration = register_message(&message.info);
+    }
+    return message.info;
+  }
+
+ private:
+  struct Message {
+    std::string domain, id, singular;
+    MessageInfo info;
+    std::uint32_t registration = 0;
+  };
+
+  std::mutex mutex;
+  // Nodes are never moved, so the strings and the infos stay valid.
+  std::unordered_map<std::string, Message> messages;
+};
+
+inline InternedMessages &interned_messages() {
+  static InternedMessages messages;
+  return messages;
+}
+} // namespace detail
+
+// All messages used by the program, ordered by their index.
+inline std::vector<const MessageInfo *> messages() {
+  return detail::message_registry().snapshot();
+}
+
+} // namespace mfk::i18n
+
+#endif
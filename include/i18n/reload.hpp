@@ -0,0 +1,202 @@
+#ifndef I18N_RELOAD_HPP
+#define I18N_RELOAD_HPP
+
+#include "mo.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/inotify.h>)
+  #include <poll.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+  #define I18N_HAS_INOTIFY 1
+#else
+  #define I18N_HAS_INOTIFY 0
+#endif
+
+namespace mfk::i18n {
+
+// Watches the catalog directories of the process wide MoBackend locale and reloads the locale on a
+// background thread whenever a catalog in them is added, replaced or removed. The new catalogs are
+// loaded completely before they are published, and lookups on other threads continue to use the
+// old ones without taking locks until then. How long the old catalogs stay valid afterwards is
+// configured with MoBackend::set_grace_period, five minutes by default.
+//
+// On Linux the directories are watched through inotify, elsewhere they are polled. Only the
+// directories in Locale::directories() are watched, so the first catalog of a new language
+// directory is found on the next reload for other reasons.
+class CatalogWatcher {
+ public:
+  struct Options {
+    // How often the directories are polled if inotify is not available. With inotify, this is how
+    // often the watcher checks whether the locale uses different directories.
+    std::chrono::milliseconds interval{1000};
+    // Changes are collected for this long before reloading, so that replacing several catalogs
+    // results in a single reload.
+    std::chrono::milliseconds delay{100};
+    // Called on the watcher thread if reloading fails, e.g. because a catalog is invalid. The old
+    // catalogs stay in use until the next change.
+    std::function<void(std::exception_ptr)> on_error;
+  };
+
+  CatalogWatcher(): CatalogWatcher(Options{}) {}
+  // Returns once the directories are watched, so all later changes are noticed.
+  explicit CatalogWatcher(Options options): options(std::move(options)) {
+    std::promise<void> ready;
+    auto started = ready.get_future();
+    thread       = std::jthread([this, ready = std::move(ready)](std::stop_token stop) mutable {
+      run(stop, ready);
+    });
+    started.wait();
+  }
+  CatalogWatcher(const CatalogWatcher &)            = delete;
+  CatalogWatcher &operator=(const CatalogWatcher &) = delete;
+  // Stops watching and waits for a reload in progress to finish.
+  ~CatalogWatcher() = default;
+
+ private:
+  static std::vector<std::filesystem::path> directories() {
+    return MoBackend::locale().directories();
+  }
+
+  void reload() {
+    try {
+      MoBackend::reload();
+    } catch (...) {
+      if (options.on_error) options.on_error(std::current_exception());
+    }
+  }
+
+  // ready is set once the current state is known.
+  void run(std::stop_token stop, std::promise<void> &ready) {
+#if I18N_HAS_INOTIFY
+    if (watch(stop, ready)) return;
+#endif
+    poll(stop, ready);
+  }
+
+  // Compares the modification times and sizes of all catalogs.
+  void poll(std::stop_token stop, std::promise<void> &ready) {
+    using State = std::vector<std::tuple<std::filesystem::path, std::filesystem::file_time_type,
+                                         std::uintmax_t>>;
+    auto state = [] {
+      State result;
+      for (auto &directory : directories()) {
+        std::error_code error;
+        for (auto &entry : std::filesystem::directory_iterator(directory, error))
+          if (entry.path().extension() == ".mo")
+            result.emplace_back(entry.path(), entry.last_write_time(error),
+                                entry.file_size(error));
+      }
+      std::sort(result.begin(), result.end());
+      return result;
+    };
+    std::mutex mutex;
+    std::condition_variable_any sleeping;
+    auto sleep = [&](std::chrono::milliseconds duration) {
+      std::unique_lock lock(mutex);
+      return !sleeping.wait_for(lock, stop, duration, [] { return false; })
+             && !stop.stop_requested();
+    };
+    State last = state();
+    ready.set_value();
+    while (sleep(options.interval)) {
+      if (State current = state(); current != last) {
+        if (!sleep(options.delay)) return;
+        reload();
+        last = state();
+      }
+    }
+  }
+
+#if I18N_HAS_INOTIFY
+  // Returns false if inotify can not be used.
+  bool watch(std::stop_token stop, std::promise<void> &ready) {
+    int wake[2];
+    if (::pipe(wake)) return false;
+    int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+      ::close(wake[0]);
+      ::close(wake[1]);
+      return false;
+    }
+    {
+      // Destroyed before the pipe is closed, so it can not write to it afterwards.
+      std::stop_callback wakeup(stop, [&] { static_cast<void>(::write(wake[1], "", 1)); });
+      // Returns false if the watcher was stopped.
+      auto wait = [&](std::chrono::milliseconds duration) {
+        pollfd fds[2] = {{fd, POLLIN, 0}, {wake[0], POLLIN, 0}};
+        ::poll(fds, 2, static_cast<int>(duration.count()));
+        return !stop.stop_requested();
+      };
+      // Returns whether a catalog changed.
+      auto drain = [&] {
+        bool changed = false;
+        alignas(inotify_event) char buffer[4096];
+        for (ssize_t length; (length = ::read(fd, buffer, sizeof buffer)) > 0;)
+          for (char *iter = buffer; iter < buffer + length;) {
+            auto *event = reinterpret_cast<inotify_event *>(iter);
+            std::string_view name(event->len ? event->name : "");
+            changed |= (event->mask & IN_Q_OVERFLOW) || name.ends_with(".mo");
+            iter += sizeof(inotify_event) + event->len;
+          }
+        return changed;
+      };
+
+      std::vector<std::filesystem::path> watched;
+      std::vector<int> watches;
+      auto update = [&] {
+        if (auto current = directories(); current != watched) {
+          for (int watch : watches)
+            ::inotify_rm_watch(fd, watch);
+          watches.clear();
+          for (auto &directory : current)
+            if (int watch = ::inotify_add_watch(fd, directory.c_str(),
+                                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+                watch >= 0)
+              watches.push_back(watch);
+          watched = std::move(current);
+        }
+      };
+      update();
+      ready.set_value();
+      while (wait(options.interval)) {
+        update();
+        if (drain()) {
+          // Collect further changes, e.g. to the catalogs of other languages.
+          if (!wait(options.delay)) break;
+          drain();
+          reload();
+          update();
+        }
+      }
+    }
+    ::close(fd);
+    ::close(wake[0]);
+    ::close(wake[1]);
+    return true;
+  }
+#endif
+
+  Options options;
+  // Declared last, so that the thread is stopped before the other members are destroyed.
+  std::jthread thread;
+};
+
+} // namespace mfk::i18n
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef I18N_STATS_HPP
+#define I18N_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <libintl.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Counts how often every message is translated for every locale and how often it misses its
+// translation, and samples the latencies of lookups and of formatting. Without it, none of this
+// code is compiled into the string classes.
+#ifndef I18N_STATS
+  #define I18N_STATS 0
+#endif
+
+// One in this many lookups and formatting calls of every thread is timed.
+#ifndef I18N_STATS_SAMPLE_RATE
+  #define I18N_STATS_SAMPLE_RATE 64
+#endif
+
+namespace mfk::i18n {
+
+struct MessageStats {
+  // The locale as reported by the catalog, e.g. Locale::languages(), or LC_MESSAGES for libintl.
+  std::string catalog;
+  std::string domain;
+  // "msgctxt\4msgid" or just "msgid"
+  std::string msgid;
+  std::uint64_t hits   = 0;
+  std::uint64_t misses = 0;
+};
+
+// Bucket i counts the samples which took less than 2^(i+1) but at least 2^i nanoseconds, the
+// first bucket also counts faster ones.
+struct LatencyHistogram {
+  std::array<std::uint64_t, 40> buckets{};
+
+  std::uint64_t count() const {
+    std::uint64_t count = 0;
+    for (auto bucket : buckets)
+      count += bucket;
+    return count;
+  }
+};
+
+struct Stats {
+  // Ordered by catalog, domain and msgid
+  std::vector<MessageStats> messages;
+  LatencyHistogram lookup;
+  LatencyHistogram format;
+  std::uint64_t sample_rate = I18N_STATS_SAMPLE_RATE;
+
+  std::string text() const;
+  std::string json() const;
+};
+
+namespace detail {
+inline std::atomic<bool> stats_enabled{true};
+
+// Escapes str for JSON, which is also used to quote strings in the text output.
+inline void append_quoted(std::string &out, std::string_view str) {
+  out += '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned char>(c));
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+#if I18N_STATS
+struct AtomicHistogram {
+  std::array<std::atomic<std::uint64_t>, LatencyHistogram{}.buckets.size()> buckets{};
+
+  void add(std::chrono::steady_clock::duration duration) {
+    auto ns     = static_cast<std::uint64_t>(std::max<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 1));
+    auto bucket = std::min<std::size_t>(std::bit_width(ns) - 1, buckets.size() - 1);
+    increment(buckets[bucket]);
+  }
+  void add_to(LatencyHistogram &histogram) const {
+    for (std::size_t i = 0; i != buckets.size(); ++i)
+      histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+  }
+
+  // Only the owning thread writes, so the increments don't need atomic read-modify-write
+  // operations.
+  static void increment(std::atomic<std::uint64_t> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+// The statistics of one thread. They are only written by that thread, stats() reads them
+// concurrently.
+class ThreadStats {
+ public:
+  struct Counters {
+    std::atomic<std::uint64_t> hits{0}, misses{0};
+  };
+
+  ThreadStats();
+  ~ThreadStats();
+
+  void record(std::string_view catalog, const char *domain, const char *msgid, bool translated) {
+    key.assign(catalog).append(1, '\0').append(domain ? domain : "");
+    key.append(1, '\0').append(msgid);
+    auto iter = messages.find(key);
+    if (iter == messages.end()) {
+      // Only this thread modifies the table and stats() reads it while holding the lock, so only
+      // insertions need to take it.
+      std::lock_guard lock(mutex);
+      iter = messages.try_emplace(key).first;
+    }
+    AtomicHistogram::increment(translated ? iter->second.hits : iter->second.misses);
+  }
+  // Returns whether the current call should be timed.
+  bool sample() {
+    if (--countdown) return false;
+    countdown = I18N_STATS_SAMPLE_RATE;
+    return true;
+  }
+
+  void add_to(Stats &stats) {
+    std::lock_guard lock(mutex);
+    for (auto &[key, counters] : messages)
+      add_to(stats, key, counters.hits.load(std::memory_order_relaxed),
+             counters.misses.load(std::memory_order_relaxed));
+    lookup.add_to(stats.lookup);
+    format.add_to(stats.format);
+  }
+  static void add_to(Stats &stats, std::string_view key, std::uint64_t hits,
+                     std::uint64_t misses) {
+    auto catalog = key.substr(0, key.find('\0'));
+    key.remove_prefix(catalog.size() + 1);
+    auto domain = key.substr(0, key.find('\0'));
+    key.remove_prefix(domain.size() + 1);
+    stats.messages.push_back(MessageStats{std::string(catalog), std::string(domain),
+                                          std::string(key), hits, misses});
+  }
+
+  AtomicHistogram lookup, format;
+
+ private:
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view str) const {
+      return std::hash<std::string_view>{}(str);
+    }
+  };
+
+  std::mutex mutex;
+  // Keys are "catalog\0domain\0msgid"
+  std::unordered_map<std::string, Counters, Hash, std::equal_to<>> messages;
+  // Reused for the lookups, so that recording does not allocate for known messages.
+  std::string key;
+  unsigned countdown = I18N_STATS_SAMPLE_RATE;
+};
+
+// All threads with statistics and the totals of threads which have exited.
+class StatsRegistry {
+ public:
+  void add(ThreadStats *stats) {
+    std::lock_guard lock(mutex);
+    threads.push_back(stats);
+  }
+  void remove(ThreadStats *stats) {
+    std::lock_guard lock(mutex);
+    std::erase(threads, stats);
+    stats->add_to(exited);
+    merge(exited.messages);
+  }
+  Stats snapshot() {
+    std::lock_guard lock(mutex);
+    Stats result = exited;
+    for (auto *stats : threads)
+      stats->add_to(result);
+    merge(result.messages);
+    return result;
+  }
+
+ private:
+  // Sorts messages and sums up the counts of different threads.
+  static void merge(std::vector<MessageStats> &messages) {
+    auto key = [](const MessageStats &message) {
+      return std::tie(message.catalog, message.domain, message.msgid);
+    };
+    std::sort(messages.begin(), messages.end(),
+              [&](auto &a, auto &b) { return key(a) < key(b); });
+    std::vector<MessageStats> merged;
+    for (auto &message : messages)
+      if (!merged.empty() && key(merged.back()) == key(message)) {
+        merged.back().hits += message.hits;
+        merged.back().misses += message.misses;
+      } else {
+        merged.push_back(std::move(message));
+      }
+    messages = std::move(merged);
+  }
+
+  std::mutex mutex;
+  std::vector<ThreadStats *> threads;
+  Stats exited;
+};
+
+inline StatsRegistry &stats_registry() {
+  static StatsRegistry registry;
+  return registry;
+}
+
+inline ThreadStats::ThreadStats() { stats_registry().add(this); }
+inline ThreadStats::~ThreadStats() { stats_registry().remove(this); }
+
+inline ThreadStats &thread_stats() {
+  static thread_local ThreadStats stats;
+  return stats;
+}
+
+// Measures a call if it is sampled.
+class StatsTimer {
+ public:
+  StatsTimer() {
+    if (stats_enabled.load(std::memory_order_relaxed) && thread_stats().sample())
+      start = std::chrono::steady_clock::now();
+  }
+  void finish(AtomicHistogram ThreadStats::*histogram) const {
+    if (start != std::chrono::steady_clock::time_point())
+      (thread_stats().*histogram).add(std::chrono::steady_clock::now() - start);
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start{};
+};
+
+// The locale a catalog translates to.
+template <typename Catalog>
+std::string_view catalog_name(const Catalog &catalog) {
+  if constexpr (requires { catalog.languages(); })
+    return catalog.languages();
+  else if constexpr (requires { Catalog::locale().languages(); })
+    return Catalog::locale().languages();
+  else if (const char *locale = std::setlocale(LC_MESSAGES, nullptr))
+    return locale;
+  else
+    return {};
+}
+
+// translated is only called if statistics are enabled.
+template <typename Catalog, typename Translated>
+void record_translation(const StatsTimer &timer, const Catalog &catalog, const char *domain,
+                        const char *msgid, Translated &&translated) {
+  timer.finish(&ThreadStats::lookup);
+  if (stats_enabled.load(std::memory_order_relaxed))
+    thread_stats().record(catalog_name(catalog), domain, msgid, translated());
+}
+inline void record_format(const StatsTimer &timer) { timer.finish(&ThreadStats::format); }
+#else
+struct StatsTimer {};
+
+template <typename Catalog, typename Translated>
+void record_translation(const StatsTimer &, const Catalog &, const char *, const char *,
+                        Translated &&) {}
+inline void record_format(const StatsTimer &) {}
+#endif
+} // namespace detail
+
+// A snapshot of the statistics of all threads, see I18N_STATS. Empty if I18N_STATS is disabled.
+inline Stats stats() {
+#if I18N_STATS
+  return detail::stats_registry().snapshot();
+#else
+  return {};
+#endif
+}
+
+// Pauses or resumes recording statistics, e.g. to only enable them on some servers. Recording is
+// enabled by default if I18N_STATS is defined.
+inline void set_stats_enabled(bool enabled) {
+  detail::stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+// One line per message with its hits and misses, followed by both histograms.
+inline std::string Stats::text() const {
+  std::string out = "# hits misses catalog domain msgid\n";
+  for (auto &message : messages) {
+    out += std::to_string(message.hits) + ' ' + std::to_string(message.misses) + ' ';
+    detail::append_quoted(out, message.catalog);
+    out += ' ';
+    detail::append_quoted(out, message.domain);
+    out += ' ';
+    detail::append_quoted(out, message.msgid);
+    out += '\n';
+  }
+  for (auto [name, histogram] : {std::pair{"lookup", &lookup}, std::pair{"format", &format}}) {
+    out += "# " + std::string(name) + " latency, 1 in " + std::to_string(sample_rate)
+           + " calls sampled\n";
+    for (std::size_t i = 0; i != histogram->buckets.size(); ++i)
+      if (histogram->buckets[i])
+        out += "< " + std::to_string(std::uint64_t(2) << i) + " ns: "
+               + std::to_string(histogram->buckets[i]) + '\n';
+  }
+  return out;
+}
+
+// {"messages": [{"catalog": ..., "domain": ..., "msgid": ..., "hits": ..., "misses": ...}, ...],
+//  "lookup": {"sample_rate": ..., "buckets": [...]}, "format": {...}}
+inline std::string Stats::json() const {
+  std::string out = "{\"messages\": [";
+  for (auto &message : messages) {
+    out += &message == messages.data() ? "{\"catalog\": " : ", {\"catalog\": ";
+    detail::append_quoted(out, message.catalog);
+    out += ", \"domain\": ";
+    detail::append_quoted(out, message.domain);
+    out += ", \"msgid\": ";
+    detail::append_quoted(out, message.msgid);
+    out += ", \"hits\": " + std::to_string(message.hits)
+           + ", \"misses\": " + std::to_string(message.misses) + '}';
+  }
+  out += ']';
+  for (auto [name, histogram] : {std::pair{"lookup", &lookup}, std::pair{"format", &format}}) {
+    out += ", \"" + std::string(name) + "\": {\"sample_rate\": " + std::to_string(sample_rate)
+           + ", \"buckets\": [";
+    for (std::size_t i = 0; i != histogram->buckets.size(); ++i)
+      out += (i ? ", " : "") + std::to_string(histogram->buckets[i]);
+    out += "]}";
+  }
+  out += '}';
+  return out;
+}
+
+} // namespace mfk::i18n
+
+#endif
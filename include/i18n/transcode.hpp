@@ -0,0 +1,229 @@
+#ifndef I18N_TRANSCODE_HPP
+#define I18N_TRANSCODE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace mfk::i18n {
+namespace detail {
+
+// Catalogs always store UTF-8, strings of other character types are transcoded. char and char8_t
+// are UTF-8, char16_t is UTF-16 and char32_t is UTF-32. wchar_t is UTF-16 or UTF-32, depending on
+// its size. Invalid sequences are replaced by U+FFFD.
+template <typename Char>
+constexpr char32_t decode(const Char *&iter, const Char *end) {
+  if constexpr (sizeof(Char) == 4) {
+    return static_cast<char32_t>(*iter++);
+  } else if constexpr (sizeof(Char) == 2) {
+    char32_t unit = static_cast<char16_t>(*iter++);
+    if (unit < 0xd800 || unit >= 0xe000) return unit;
+    if (unit < 0xdc00 && iter != end && static_cast<char16_t>(*iter) >= 0xdc00
+        && static_cast<char16_t>(*iter) < 0xe000)
+      return 0x10000 + ((unit - 0xd800) << 10) + (static_cast<char16_t>(*iter++) - 0xdc00);
+    return 0xfffd;
+  } else {
+    auto lead = static_cast<unsigned char>(*iter++);
+    if (lead < 0x80) return lead;
+    int extra = lead >= 0xf8 ? -1 : lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : -1;
+    if (extra < 0) return 0xfffd;
+    char32_t code = lead & (0x3f >> extra);
+    for (; extra; --extra) {
+      if (iter == end || (static_cast<unsigned char>(*iter) & 0xc0) != 0x80) return 0xfffd;
+      code = code << 6 | (static_cast<unsigned char>(*iter++) & 0x3f);
+    }
+    return code;
+  }
+}
+
+// Writes code to out, which can be nullptr to only measure it. Returns the number of code units.
+template <typename Char>
+constexpr std::size_t encode(char32_t code, Char *out) {
+  if constexpr (sizeof(Char) == 4) {
+    if (out) *out = static_cast<Char>(code);
+    return 1;
+  } else if constexpr (sizeof(Char) == 2) {
+    if (code < 0x10000) {
+      if (out) *out = static_cast<Char>(code);
+      return 1;
+    }
+    if (out) {
+      out[0] = static_cast<Char>(0xd800 + ((code - 0x10000) >> 10));
+      out[1] = static_cast<Char>(0xdc00 + ((code - 0x10000) & 0x3ff));
+    }
+    return 2;
+  } else {
+    std::size_t length = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+    if (out) {
+      if (length == 1) {
+        *out = static_cast<Char>(code);
+      } else {
+        *out = static_cast<Char>((0xf00 >> length) | (code >> (6 * (length - 1))));
+        for (std::size_t i = 1; i != length; ++i)
+          out[i] = static_cast<Char>(0x80 | ((code >> (6 * (length - 1 - i))) & 0x3f));
+      }
+    }
+    return length;
+  }
+}
+
+// Number of code units of To needed for [begin, end).
+template <typename To, typename From>
+constexpr std::size_t transcoded_length(const From *begin, const From *end) {
+  if constexpr (sizeof(To) == sizeof(From)) return end - begin;
+  std::size_t length = 0;
+  while (begin != end)
+    length += encode(decode(begin, end), static_cast<To *>(nullptr));
+  return length;
+}
+template <typename To, typename From>
+constexpr To *transcode(const From *begin, const From *end, To *out) {
+  if constexpr (sizeof(To) == sizeof(From)) {
+    while (begin != end)
+      *out++ = static_cast<To>(*begin++);
+    return out;
+  }
+  while (begin != end)
+    out += encode(decode(begin, end), out);
+  return out;
+}
+
+template <typename Char>
+std::basic_string<Char> transcode(std::string_view utf8) {
+  const char *begin = utf8.data(), *end = begin + utf8.size();
+  std::basic_string<Char> result(transcoded_length<Char>(begin, end), Char());
+  transcode(begin, end, result.data());
+  return result;
+}
+
+// Transcoded copies of UTF-8 strings, e.g. of translations. Every string is transcoded only once
+// per cache, and the copies are NUL terminated and live as long as the cache.
+//
+// Catalogs which own their translations (see Locale) keep a cache keyed by the address and length
+// of the translations, so that the copies are freed together with the catalog. The process wide
+// cache used for other catalogs is keyed by the contents instead, since their addresses could be
+// reused for other strings, and never frees its copies. Recent lookups are remembered per thread,
+// so hits neither take locks nor hash the strings.
+template <typename Char, bool ByAddress = true>
+class TranscodingCache {
+ public:
+  TranscodingCache() = default;
+  TranscodingCache(const TranscodingCache &)            = delete;
+  TranscodingCache &operator=(const TranscodingCache &) = delete;
+
+  std::basic_string_view<Char> get(std::string_view utf8) const {
+    auto slot      = reinterpret_cast<std::uintptr_t>(utf8.data()) >> 3;
+    Recent &recent = recently_used[(slot ^ utf8.size()) & (recent_size - 1)];
+    // Ids are never reused, so entries of destroyed caches don't match.
+    if (recent.cache == id && recent.address == utf8.data() && recent.original.size() == utf8.size()
+        && (ByAddress || recent.original == utf8))
+      return recent.copy;
+    std::basic_string_view<Char> copy;
+    std::string_view original;
+    {
+      std::shared_lock lock(mutex);
+      if (auto iter = strings.find(key(utf8)); iter != strings.end()) {
+        original = view(iter->first);
+        copy     = iter->second;
+      }
+    }
+    if (!copy.data()) {
+      std::lock_guard lock(mutex);
+      auto [iter, inserted] = strings.try_emplace(Key(key(utf8)));
+      if (inserted) iter->second = transcode<Char>(utf8);
+      original = view(iter->first);
+      copy     = iter->second;
+    }
+    recent = Recent{id, utf8.data(), original, copy};
+    return copy;
+  }
+
+ private:
+  using Key = std::conditional_t<ByAddress, std::pair<const char *, std::size_t>, std::string>;
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::pair<const char *, std::size_t> key) const {
+      return std::hash<const char *>{}(key.first) ^ key.second;
+    }
+    std::size_t operator()(std::string_view str) const {
+      return std::hash<std::string_view>{}(str);
+    }
+  };
+  struct Recent {
+    std::uint64_t cache = 0;
+    const char *address = nullptr;
+    // The string in the cache's own keys for caches keyed by contents
+    std::string_view original;
+    std::basic_string_view<Char> copy;
+  };
+  static constexpr std::size_t recent_size = 64;
+
+  static auto key(std::string_view utf8) {
+    if constexpr (ByAddress)
+      return std::pair(utf8.data(), utf8.size());
+    else
+      return utf8;
+  }
+  static std::string_view view(const Key &key) {
+    if constexpr (ByAddress)
+      return {key.first, key.second};
+    else
+      return key;
+  }
+
+  static inline std::atomic<std::uint64_t> next_id{1};
+  static inline thread_local Recent recently_used[recent_size];
+
+  const std::uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  mutable std::shared_mutex mutex;
+  mutable std::unordered_map<Key, std::basic_string<Char>, Hash, std::equal_to<>> strings;
+};
+
+template <typename Char>
+TranscodingCache<Char, false> &transcoding_cache() {
+  static TranscodingCache<Char, false> cache;
+  return cache;
+}
+
+// The transcoding caches of a catalog for all character types.
+class TranscodedStrings {
+ public:
+  template <typename Char>
+  std::basic_string_view<Char> get(std::string_view utf8) const {
+    return std::get<TranscodingCache<Char>>(caches).get(utf8);
+  }
+
+ private:
+  std::tuple<TranscodingCache<char8_t>, TranscodingCache<char16_t>, TranscodingCache<char32_t>,
+             TranscodingCache<wchar_t>>
+      caches;
+};
+
+// translation converted to Char. Catalogs which own their translations provide
+//
+//   template <typename Char>
+//   std::basic_string_view<Char> transcoded(std::string_view translation) const;
+//
+// which returns a copy owned by the catalog, see TranscodedStrings. Translations of other
+// catalogs are copied into the process wide cache.
+template <typename Char, typename Catalog>
+std::basic_string_view<Char> transcoded_in(const Catalog &catalog, std::string_view translation) {
+  if constexpr (requires { catalog.template transcoded<Char>(translation); })
+    return catalog.template transcoded<Char>(translation);
+  else
+    return transcoding_cache<Char>().get(translation);
+}
+
+} // namespace detail
+} // namespace mfk::i18n
+
+#endif
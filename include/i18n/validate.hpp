@@ -0,0 +1,225 @@
+#ifndef I18N_VALIDATE_HPP
+#define I18N_VALIDATE_HPP
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Checks the translated format strings of every catalog loaded by MoBackend against their originals
+// and rejects translations which could fail to format, see check_format_translation. Rejected
+// messages fall back to later catalogs of the locale or to the untranslated string, and are listed
+// by Locale::format_errors().
+#ifndef I18N_VALIDATE_FORMATS
+  #define I18N_VALIDATE_FORMATS 0
+#endif
+
+namespace mfk::i18n {
+
+// A translation rejected by I18N_VALIDATE_FORMATS.
+struct FormatError {
+  std::string domain;
+  // The name of the catalog's directory, as in Locale::origin
+  std::string locale;
+  // "msgctxt\4msgid" or just "msgid"
+  std::string key;
+  std::string reason;
+};
+
+namespace detail {
+
+// A replacement field of a format string.
+struct FormatField {
+  // The index of the argument, -1 for named arguments
+  int arg;
+  std::string_view spec;
+  // Whether the field is a dynamic width or precision in the spec of another field
+  bool nested = false;
+};
+
+// Splits a format string in the syntax of std::format and fmt into its replacement fields, or
+// returns std::nullopt if it is not a valid format string.
+inline std::optional<std::vector<FormatField>> format_fields(std::string_view format) {
+  std::vector<FormatField> fields;
+  bool automatic = false, manual = false;
+  int next       = 0;
+  // Parses the argument id at the start of rest, which is removed.
+  auto arg_id = [&](std::string_view &rest) -> std::optional<int> {
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    auto is_alpha = [](char c) {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    };
+    if (!rest.empty() && is_digit(rest[0])) {
+      if (automatic) return std::nullopt;
+      manual    = true;
+      int value = 0;
+      for (; !rest.empty() && is_digit(rest[0]); rest.remove_prefix(1))
+        if ((value = value * 10 + (rest[0] - '0')) > 0xffff) return std::nullopt;
+      return value;
+    }
+    if (!rest.empty() && is_alpha(rest[0])) {
+      while (!rest.empty() && (is_alpha(rest[0]) || is_digit(rest[0])))
+        rest.remove_prefix(1);
+      return -1;
+    }
+    if (manual) return std::nullopt;
+    automatic = true;
+    return next++;
+  };
+
+  std::string_view rest = format;
+  while (!rest.empty()) {
+    char c = rest[0];
+    rest.remove_prefix(1);
+    if (c == '}') {
+      if (rest.empty() || rest[0] != '}') return std::nullopt;
+      rest.remove_prefix(1);
+      continue;
+    }
+    if (c != '{') continue;
+    if (!rest.empty() && rest[0] == '{') {
+      rest.remove_prefix(1);
+      continue;
+    }
+
+    auto arg = arg_id(rest);
+    if (!arg || rest.empty()) return std::nullopt;
+    std::size_t field = fields.size();
+    fields.push_back(FormatField{*arg, {}});
+    if (rest[0] == ':') {
+      rest.remove_prefix(1);
+      const char *spec = rest.data();
+      // Nested fields can only contain an argument id.
+      while (!rest.empty() && rest[0] != '}') {
+        if (rest[0] != '{') {
+          rest.remove_prefix(1);
+          continue;
+        }
+        rest.remove_prefix(1);
+        auto nested = arg_id(rest);
+        if (!nested || rest.empty() || rest[0] != '}') return std::nullopt;
+        rest.remove_prefix(1);
+        fields.push_back(FormatField{*nested, {}, true});
+      }
+      fields[field].spec = std::string_view(spec, rest.data() - spec);
+    }
+    if (rest.empty() || rest[0] != '}') return std::nullopt;
+    rest.remove_prefix(1);
+  }
+  return fields;
+}
+
+// The parts of a standard format spec, [[fill]align][sign][#][0][width][.precision][L][type].
+struct StandardSpec {
+  std::string_view align, sign, alternate, zero, width, precision, locale, type;
+};
+
+// Returns std::nullopt if spec is not a standard spec, e.g. because it is for a chrono type.
+inline std::optional<StandardSpec> standard_spec(std::string_view spec) {
+  StandardSpec result;
+  auto take = [&](std::size_t length) {
+    auto part = spec.substr(0, length);
+    spec.remove_prefix(length);
+    return part;
+  };
+  auto is_align = [](char c) { return c == '<' || c == '>' || c == '^'; };
+  // The fill character can be any code point except for braces.
+  auto lead = static_cast<unsigned char>(spec.empty() ? 0 : spec[0]);
+  std::size_t fill = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 1;
+  if (!spec.empty() && is_align(spec[0]))
+    result.align = take(1);
+  else if (spec.size() > fill && is_align(spec[fill]))
+    result.align = take(fill + 1);
+  if (!spec.empty() && (spec[0] == '+' || spec[0] == '-' || spec[0] == ' ')) result.sign = take(1);
+  if (!spec.empty() && spec[0] == '#') result.alternate = take(1);
+  if (!spec.empty() && spec[0] == '0') result.zero = take(1);
+  // A number or a nested field
+  auto count = [&] {
+    if (!spec.empty() && spec[0] == '{') return take(spec.find('}') + 1);
+    return take(std::min(spec.find_first_not_of("0123456789"), spec.size()));
+  };
+  result.width = count();
+  if (!spec.empty() && spec[0] == '.') {
+    result.precision = take(1);
+    auto digits      = count();
+    if (digits.empty()) return std::nullopt;
+    result.precision = std::string_view(result.precision.data(), digits.size() + 1);
+  }
+  if (!spec.empty() && spec[0] == 'L') result.locale = take(1);
+  if (spec.size() == 1 && std::string_view("aAbBcdeEfFgGopsxX?").find(spec[0]) != spec.npos)
+    result.type = take(1);
+  if (!spec.empty()) return std::nullopt;
+  return result;
+}
+
+// A translated spec is compatible with the spec of the original if it only uses options the
+// original uses as well, maybe with different values, and the same presentation type. Other specs
+// have to be identical.
+inline bool compatible_specs(std::string_view translated, std::string_view original) {
+  if (translated == original) return true;
+  auto a = standard_spec(translated), b = standard_spec(original);
+  if (!a || !b) return false;
+  auto covered = [](std::string_view a, std::string_view b) { return a.empty() || !b.empty(); };
+  return covered(a->align, b->align) && covered(a->sign, b->sign)
+         && covered(a->alternate, b->alternate) && covered(a->zero, b->zero)
+         && covered(a->width, b->width) && covered(a->precision, b->precision)
+         && covered(a->locale, b->locale) && (a->type.empty() || a->type == b->type);
+}
+
+} // namespace detail
+
+// Checks a translation, i.e. all plural forms separated by NUL characters, against the original
+// format strings. Every form has to be a valid format string which only uses arguments of the
+// original, with compatible specs. Translations of messages without plural forms also have to use
+// all arguments. Returns a description of the first problem, or an empty string if the translation
+// is fine. Originals without replacement fields are not format strings, so their translations are
+// not checked.
+inline std::string check_format_translation(std::string_view singular, std::string_view plural,
+                                            std::string_view translation) {
+  auto original = detail::format_fields(singular);
+  if (!original) return {};
+  if (!plural.empty()) {
+    auto plural_fields = detail::format_fields(plural);
+    if (!plural_fields) return {};
+    original->insert(original->end(), plural_fields->begin(), plural_fields->end());
+  }
+  if (original->empty()) return {};
+
+  for (int form = 0;; ++form) {
+    auto end    = std::min(translation.find('\0'), translation.size());
+    auto prefix = plural.empty() ? std::string() : "form " + std::to_string(form) + ' ';
+    auto fields = detail::format_fields(translation.substr(0, end));
+    if (!fields) return prefix + "is not a valid format string";
+    for (auto &field : *fields) {
+      if (field.arg < 0) return prefix + "uses a named argument";
+      bool used = false, compatible = false;
+      for (auto &candidate : *original)
+        if (candidate.arg == field.arg) {
+          used = true;
+          compatible |= (!field.nested || candidate.nested)
+                        && detail::compatible_specs(field.spec, candidate.spec);
+        }
+      if (!used)
+        return prefix + "uses argument " + std::to_string(field.arg)
+               + ", which the original does not use";
+      if (!compatible)
+        return prefix + "uses an incompatible format spec for argument "
+               + std::to_string(field.arg);
+    }
+    // Plural forms often leave out the number, e.g. "an apple".
+    if (plural.empty())
+      for (auto &candidate : *original) {
+        bool found = false;
+        for (auto &field : *fields)
+          found |= field.arg == candidate.arg;
+        if (!found) return "does not use argument " + std::to_string(candidate.arg);
+      }
+    if (end == translation.size()) return {};
+    translation.remove_prefix(end + 1);
+  }
+}
+
+} // namespace mfk::i18n
+
+#endif
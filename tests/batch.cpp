@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/batch.hpp>
+#include <i18n/mo.hpp>
+#include <string>
+
+using mfk::i18n::Batch;
+using mfk::i18n::CompileTimeString;
+
+TEST_CASE("batches format messages into one buffer", "[batch]") {
+  std::locale::global(std::locale("C"));
+  textdomain("testcases");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello {}!")>();
+  constexpr auto world  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  mfk::i18n::I18NStringCrossDomain runtime("testcases", "Hello {}!", "Hello {}!");
+
+  Batch batch;
+  REQUIRE(batch.empty());
+  REQUIRE(batch.add(hello, "Max") == 0);
+  REQUIRE(batch.add(world) == 1);
+  REQUIRE(batch.add(apples, 1) == 2);
+  REQUIRE(batch.add(apples, 3) == 3);
+  REQUIRE(batch.add(runtime, 42) == 4);
+
+  // Nothing is translated before the batch is resolved
+  REQUIRE(batch.size() == 5);
+  REQUIRE(batch.text().empty());
+  REQUIRE(batch.offsets().size() == 1);
+
+  batch.resolve();
+  REQUIRE(batch.size() == 5);
+  REQUIRE(batch[0] == "Hello Max!");
+  REQUIRE(batch[1] == "Hello world!");
+  REQUIRE(batch[2] == "I ate 1 apple.");
+  REQUIRE(batch[3] == "I ate 3 apples.");
+  REQUIRE(batch[4] == "Hello 42!");
+  REQUIRE(batch.text() == "Hello Max!Hello world!I ate 1 apple.I ate 3 apples.Hello 42!");
+  REQUIRE(batch.offsets().size() == 6);
+  REQUIRE(batch.offsets()[2] == 22);
+
+  // Resolving again only handles the messages added since
+  REQUIRE(batch.add(world) == 5);
+  batch.resolve();
+  REQUIRE(batch[5] == "Hello world!");
+  REQUIRE(batch[0] == "Hello Max!");
+
+  batch.clear();
+  REQUIRE(batch.empty());
+  REQUIRE(batch.add(world) == 0);
+  batch.resolve();
+  REQUIRE(batch.text() == "Hello world!");
+}
+
+TEST_CASE("batches format messages without arguments", "[batch]") {
+  std::locale::global(std::locale("C"));
+  textdomain("testcases");
+
+  constexpr auto braces = mfk::i18n::build_I18NString<CompileTimeString("{{braces}}")>();
+
+  Batch batch;
+  batch.add(braces);
+  batch.resolve();
+  REQUIRE(batch[0] == braces());
+  REQUIRE(batch[0] == "{braces}");
+}
+
+TEST_CASE("batches copy the arguments until they are resolved", "[batch]") {
+  using mfk::i18n::MoBackend;
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  auto german = MoBackend::locale("de_DE.UTF-8");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello {}!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+
+  Batch batch;
+  for (int i = 0; i != 1000; ++i) {
+    batch.add(hello.in(german), std::to_string(i));
+    batch.add(apples.in(german), i);
+  }
+  Batch moved = std::move(batch);
+  REQUIRE(batch.empty());
+  REQUIRE(moved.size() == 2000);
+  moved.resolve();
+  REQUIRE(moved[0] == "Hallo 0!");
+  REQUIRE(moved[3] == "Ich habe 1 Apfel gegessen.");
+  REQUIRE(moved[1998] == "Hallo 999!");
+  REQUIRE(moved[1999] == "Ich habe 999 Äpfel gegessen.");
+
+  SECTION("failures discard the queued messages") {
+    mfk::i18n::I18NStringCrossDomain missing("testcases", "{} and {}", "{} and {}");
+    moved.add(hello.in(german), std::string("Max"));
+    moved.add(missing, 1);
+    REQUIRE(moved.size() == 2002);
+    REQUIRE_THROWS(moved.resolve());
+    REQUIRE(moved.size() == 2000);
+    REQUIRE(moved.offsets().size() == 2001);
+    REQUIRE(moved.text().ends_with("Ich habe 999 Äpfel gegessen."));
+  }
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/cache.hpp>
+#include <i18n/format.hpp>
+#include <cstring>
+#include <string>
+
+using mfk::i18n::detail::TranslationCache;
+
+namespace {
+constexpr char domain[]       = "testcases";
+constexpr char msgid[]        = "Hello world!";
+constexpr char other_msgid[]  = "Hello planet!\0Hello planets!";
+constexpr char translation[]  = "Hallo Welt!";
+constexpr char translation2[] = "Hallo Planeten!";
+
+struct Point {
+  int x, y;
+};
+} // namespace
+
+template <>
+struct fmtstd::formatter<Point> : fmtstd::formatter<int> {
+  auto format(Point point, auto &context) const {
+    auto out = fmtstd::formatter<int>::format(point.x, context);
+    *out++   = '/';
+    context.advance_to(out);
+    return fmtstd::formatter<int>::format(point.y, context);
+  }
+};
+
+TEST_CASE("translation cache memoizes lookups", "[cache]") {
+  TranslationCache cache;
+  int lookups   = 0;
+  auto singular = [&] {
+    ++lookups;
+    return translation;
+  };
+  auto plural = [&] {
+    ++lookups;
+    return translation2;
+  };
+
+  SECTION("repeated lookups hit the cache") {
+    REQUIRE(cache.get(domain, msgid, singular).data() == translation);
+    REQUIRE(cache.get(domain, msgid, singular).data() == translation);
+    REQUIRE(lookups == 1);
+  }
+
+  SECTION("plural lookups are keyed by n") {
+    REQUIRE(cache.get(domain, other_msgid, 2, plural).data() == translation2);
+    REQUIRE(cache.get(domain, other_msgid, 2, plural).data() == translation2);
+    REQUIRE(cache.get(domain, other_msgid, 3, plural).data() == translation2);
+    REQUIRE(lookups == 2);
+  }
+
+  SECTION("invalidation forces a new lookup") {
+    REQUIRE(cache.get(domain, msgid, singular).data() == translation);
+    mfk::i18n::invalidate_translations();
+    REQUIRE(cache.get(domain, msgid, singular).data() == translation);
+    REQUIRE(lookups == 2);
+  }
+
+  SECTION("changing the textdomain invalidates the cache") {
+    auto generation = mfk::i18n::catalog_generation();
+    mfk::i18n::textdomain("testcases");
+    REQUIRE(generation != mfk::i18n::catalog_generation());
+  }
+}
+
+#if USE_FMT
+TEST_CASE("parsed format strings give the same results as fmt", "[cache]") {
+  using mfk::i18n::detail::ParsedFormat;
+  auto check = [](std::string_view format, const auto &...args) {
+    auto store = fmt::make_format_args(args...);
+    ParsedFormat parsed;
+    REQUIRE(parsed.parse(format, store));
+    for (int i = 0; i != 2; ++i) {
+      fmt::memory_buffer buffer;
+      parsed.format(buffer, store);
+      REQUIRE(fmt::to_string(buffer) == fmt::vformat(format, store));
+    }
+  };
+
+  check("I ate {} apples.", 2);
+  check("{1} {0}: {0:>{2}}", "a", 2.5, 6);
+  check("{{literal}} {:.3f} {:x}}}", 3.14159, 255u);
+  check("{:*^9}|{:<4}|", std::string("mid"), true);
+  check("{:03} at {}", Point{1, 2}, static_cast<const void *>(nullptr));
+
+  ParsedFormat parsed;
+  auto store = fmt::make_format_args(1);
+  REQUIRE_FALSE(parsed.parse("{name}", store));
+  // Nested automatic fields would be numbered from 0 when the spec is parsed for other types
+  auto nested = fmt::make_format_args(1, 4);
+  REQUIRE_FALSE(parsed.parse("{:>{}}", nested));
+
+  // Fields using an explicit locale are left to fmt
+  const std::locale locale = std::locale::classic();
+  fmt::memory_buffer buffer;
+  REQUIRE(parsed.parse("{} {:L}", nested));
+  REQUIRE_FALSE(parsed.format(buffer, nested, &locale));
+  REQUIRE(buffer.size() == 0);
+  REQUIRE(parsed.parse("{} {}", nested));
+  REQUIRE(parsed.format(buffer, nested, &locale));
+  REQUIRE(fmt::to_string(buffer) == "1 4");
+}
+
+TEST_CASE("format cache checks reused buffers", "[cache]") {
+  mfk::i18n::detail::FormatCache cache;
+  auto format = [&](std::string_view format, auto... args) {
+    fmt::memory_buffer buffer;
+    cache.vformat_to(buffer, format, fmt::make_format_args(args...));
+    return fmt::to_string(buffer);
+  };
+  char buffer[] = "{:>4}|{}";
+  REQUIRE(format(buffer, 1, 2) == "   1|2");
+  std::strcpy(buffer, "{}|{:>4}");
+  REQUIRE(format(buffer, 1, 2) == "1|   2");
+
+  // Cached for int, then used with other types
+  REQUIRE(format("{:>{}}|{}", 1, 4, 2) == "   1|2");
+  REQUIRE(format("{:>{}}|{}", "a", 3, "b") == "  a|b");
+  REQUIRE(format("{0:>{1}}|{2}", 1, 4, 2) == "   1|2");
+  REQUIRE(format("{0:>{1}}|{2}", "a", 3, "b") == "  a|b");
+}
+#endif
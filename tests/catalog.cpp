@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/catalog.hpp>
+#include <i18n/mo.hpp>
+#include <i18n/simple.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace std::string_literals;
+using mfk::i18n::CompiledCatalog;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::MoFile;
+
+namespace {
+std::filesystem::path catalog_path() {
+  return std::filesystem::temp_directory_path() / "i18n-catalog-test.i18n";
+}
+
+void write(const std::string &catalog) {
+  std::ofstream(catalog_path(), std::ios::binary).write(catalog.data(), catalog.size());
+}
+} // namespace
+
+// TEST_CATALOG is compiled from de_DE/LC_MESSAGES/testcases.po by i18n-compile-catalog.
+TEST_CASE("compiled catalogs translate like .mo files", "[catalog]") {
+  CompiledCatalog catalog(TEST_CATALOG);
+  MoFile mo(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo");
+
+  REQUIRE(catalog.domain() == "testcases");
+  REQUIRE(catalog.header().starts_with("Project-Id-Version: i18n_tests"));
+  REQUIRE(catalog.size() == mo.size() - 1);
+  for (std::uint32_t i = 0; i != mo.size(); ++i) {
+    std::string key(mo.key(i));
+    if (key.empty()) continue;
+    REQUIRE(catalog.translate("testcases", key.c_str()) == mo.find(key));
+    for (unsigned long n : {0, 1, 2})
+      REQUIRE(catalog.translate(nullptr, key.c_str(), "plural", n) == mo.find_plural(key, n));
+  }
+
+  REQUIRE(catalog.translate("testcases", "Goodbye world!") == "Goodbye world!"s);
+  REQUIRE(catalog.translate("testcases", "Unknown", "Unknowns", 2) == "Unknowns"s);
+  REQUIRE(catalog.translate("other", "Hello world!") == "Hello world!"s);
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto pi     = mfk::i18n::build_I18NString<CompileTimeString("pi is {:.4Lf}.")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  REQUIRE(hello.in(catalog).view() == "Hallo Welt!"s);
+  REQUIRE(pi.in(catalog)(3.14159265) == "Pi ist 3.1416.");
+  REQUIRE(apples.in(catalog)(2) == "Ich habe 2 Äpfel gegessen.");
+
+  CompiledCatalog empty;
+  REQUIRE(empty.translate("testcases", "Hello world!") == "Hello world!"s);
+}
+
+TEST_CASE("compiled catalogs format with pre-parsed strings", "[catalog]") {
+  write(CompiledCatalog::compile(
+      "formats", "Plural-Forms: nplurals=3; plural=n==1 ? 0 : n==2 ? 1 : 2;\n",
+      {{"{} of {}", "{1} von {0}"},
+       {"{{{}}}", "{{{:>4}}}"},
+       {"{name}", "{name}!"},
+       {"{} file", "{} Datei\0{} Dateien\0{} Dateien!"s},
+       {"ctx\4{:%H:%M}", "{:%H.%M}"}}));
+  CompiledCatalog catalog(catalog_path());
+  std::filesystem::remove(catalog_path());
+
+  auto format = [&](std::string_view format, auto... args) {
+    fmt::memory_buffer buffer;
+    catalog.vformat_to(buffer, format, fmt::make_format_args(args...));
+    return fmt::to_string(buffer);
+  };
+  REQUIRE(format(catalog.translate(nullptr, "{} of {}"), 1, 2) == "2 von 1");
+  REQUIRE(format(catalog.translate(nullptr, "{{{}}}"), 7) == "{   7}");
+  REQUIRE(format(catalog.translate(nullptr, "{} file", "{} files", 1), 1) == "1 Datei");
+  REQUIRE(format(catalog.translate(nullptr, "{} file", "{} files", 2), 2) == "2 Dateien");
+  REQUIRE(format(catalog.translate(nullptr, "{} file", "{} files", 5), 5) == "5 Dateien!");
+  REQUIRE(catalog.translate(nullptr, "ctx\4{:%H:%M}") == "{:%H.%M}"s);
+  REQUIRE(catalog.plural_forms().nplurals() == 3);
+  // Strings which are not pre-parsed are formatted by fmt.
+  REQUIRE(format(catalog.translate(nullptr, "{name}"), fmt::arg("name", "x")) == "x!");
+  REQUIRE(format("{} {}", 1, 2) == "1 2");
+  REQUIRE(format(catalog.translate(nullptr, "{} of {}").substr(4), 1, 2) == "von 1");
+  REQUIRE_THROWS_AS(format(catalog.translate(nullptr, "{} of {}"), 1), fmt::format_error);
+}
+
+TEST_CASE("invalid compiled catalogs are rejected", "[catalog]") {
+  REQUIRE_THROWS_AS(CompiledCatalog::compile("dup", "", {{"a", "b"}, {"a", "c"}}),
+                    std::runtime_error);
+
+  std::string catalog = CompiledCatalog::compile("test", "", {{"a", "b"}, {"c", "d"}});
+  for (std::size_t size : {std::size_t(0), std::size_t(16), catalog.size() - 8}) {
+    write(catalog.substr(0, size));
+    REQUIRE_THROWS(CompiledCatalog(catalog_path()));
+  }
+  // The offset of the first slot's key beyond the end
+  catalog[catalog[24] + 8 + 3] = '\x7f';
+  write(catalog);
+  REQUIRE_THROWS_AS(CompiledCatalog(catalog_path()), std::runtime_error);
+  std::filesystem::remove(catalog_path());
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/mo.hpp>
+#include <i18n/simple.hpp>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::Locale;
+using mfk::i18n::MoBackend;
+
+// The domain "embedded" is compiled into the tests from de_DE/LC_MESSAGES/testcases.po and
+// de_AT/LC_MESSAGES/testcases.po by target_embed_catalogs.
+TEST_CASE("embedded catalogs are used without files", "[embedded]") {
+  constexpr auto hello = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+
+  Locale austrian("de_AT:de", {}, "embedded");
+  REQUIRE(austrian.directories().empty());
+  REQUIRE(austrian.translate(nullptr, "Hello world!") == "Servus Welt!");
+  REQUIRE(austrian.origin("embedded", "Hello world!") == "de_AT");
+  REQUIRE(austrian.translate(nullptr, "Hello planet!", "Hello planets!", 2) == "Hallo Planeten!");
+  REQUIRE(austrian.origin("embedded", "Hello planet!") == "de");
+  REQUIRE(hello.in(austrian).view() == "Servus Welt!"s);
+
+  Locale german("de_DE.UTF-8", {}, "embedded");
+  REQUIRE(hello.in(german).view() == "Hallo Welt!"s);
+  REQUIRE(german.translate("embedded", "Hello world!") == "Hallo Welt!");
+  REQUIRE(Locale("fr", {}, "embedded").translate(nullptr, "Hello world!") == "Hello world!");
+
+  // Embedded domains are available without selecting them, but bound domains use the files.
+  REQUIRE(Locale("de").translate("embedded", "Hello world!") == "Hallo Welt!");
+  REQUIRE(Locale("de", {{"embedded", TEST_SOURCE_DIR}}).translate("embedded", "Hello world!")
+          == "Hello world!");
+
+  std::vector<std::string> locales;
+  for (auto *catalog : mfk::i18n::embedded_catalogs())
+    if (catalog->domain == "embedded"s) locales.push_back(catalog->locale);
+  REQUIRE(locales == std::vector<std::string>{"de", "de_AT"});
+}
+
+TEST_CASE("MoBackend switches between embedded catalogs", "[embedded]") {
+  MoBackend::textdomain("embedded");
+  MoBackend::set_language("de_AT");
+  REQUIRE(MoBackend::translate(nullptr, "Hello world!") == "Servus Welt!"s);
+  MoBackend::set_language("de");
+  REQUIRE(MoBackend::translate(nullptr, "Hello world!") == "Hallo Welt!"s);
+  MoBackend::set_language("C");
+  REQUIRE(MoBackend::translate(nullptr, "Hello world!") == "Hello world!"s);
+  MoBackend::textdomain("messages");
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/handle.hpp>
+#include <i18n/mo.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::MessageHandle;
+using mfk::i18n::MoBackend;
+using mfk::i18n::PluralMessageHandle;
+using namespace std::string_literals;
+
+namespace {
+// Initialized in unspecified order with the registration of the literal, which can come later.
+const MessageHandle early_label =
+    mfk::i18n::build_I18NString<CompileTimeString("Registered early")>();
+} // namespace
+
+TEST_CASE("message handles store messages in 4 bytes", "[handle]") {
+  std::locale::global(std::locale("C"));
+  textdomain("testcases");
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  auto german = MoBackend::locale("de_DE.UTF-8");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+
+  std::vector<MessageHandle> labels(3);
+  REQUIRE(labels[0].empty());
+  labels[0] = hello;
+  labels[1] = MessageHandle::intern("testcases", "Hello {}!");
+  mfk::i18n::I18NStringCrossDomain runtime("testcases", "Hello {}!", "Hello {}!");
+  labels[2] = MessageHandle(runtime);
+  PluralMessageHandle counter = apples;
+
+  REQUIRE(labels[0].index() == decltype(hello)::info().index());
+  REQUIRE(&labels[0].info() == &decltype(hello)::info());
+  REQUIRE(labels[1] == labels[2]);
+  REQUIRE(labels[1].info().key() == "Hello {}!");
+  REQUIRE(mfk::i18n::messages()[labels[1].index()] == &labels[1].info());
+  REQUIRE(MessageHandle::from_index(labels[0].index()) == labels[0]);
+  REQUIRE_FALSE(early_label.empty());
+  REQUIRE(early_label.info().key() == "Registered early");
+  REQUIRE(std::string_view(early_label) == "Registered early");
+  auto messages = mfk::i18n::messages();
+  REQUIRE(std::count_if(messages.begin(), messages.end(),
+                        [](auto *info) { return info->key() == "Registered early"; })
+          == 1);
+
+  REQUIRE(std::string_view(labels[0]) == "Hello world!");
+  REQUIRE(labels[1]("Max") == "Hello Max!");
+  REQUIRE(counter[2] == "I ate {} apples."s);
+  REQUIRE(counter(1) == "I ate 1 apple.");
+  REQUIRE(std::string_view(mfk::i18n::I18NStringCrossDomain(labels[1])) == "Hello {}!");
+
+  REQUIRE(labels[0].in(german).view() == "Hallo Welt!");
+  REQUIRE(labels[1].in(german)("Max") == "Hallo Max!");
+  REQUIRE(counter.in(german)(2) == "Ich habe 2 Äpfel gegessen.");
+}
@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/image.hpp>
+#include <i18n/simple.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace std::string_literals;
+using mfk::i18n::CatalogImage;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::ImageBackend;
+using mfk::i18n::Locale;
+
+namespace {
+Locale austrian() { return Locale("de_AT:de_DE", {{"testcases", TEST_SOURCE_DIR}}, "testcases"); }
+
+std::filesystem::path image_path() {
+  return std::filesystem::temp_directory_path() / "i18n-image-test.img";
+}
+} // namespace
+
+TEST_CASE("catalog images translate like their locale", "[image]") {
+  Locale locale = austrian();
+  CatalogImage::write(locale, image_path());
+  CatalogImage image(image_path());
+  std::filesystem::remove(image_path());
+
+  REQUIRE(image.languages() == "de_AT:de_DE");
+  REQUIRE(image.default_domain() == "testcases");
+  REQUIRE(image.size() == CatalogImage::compile(locale).size());
+
+  std::size_t entries = 0;
+  locale.for_each_entry("testcases", [&](std::string_view key, std::string_view,
+                                         std::string_view origin) {
+    ++entries;
+    std::string msgid(key);
+    REQUIRE(image.translate("testcases", msgid.c_str())
+            == locale.translate("testcases", msgid.c_str()));
+    REQUIRE(image.translate(nullptr, msgid.c_str(), "plural", 2)
+            == locale.translate(nullptr, msgid.c_str(), "plural", 2));
+    REQUIRE(image.origin("testcases", key) == origin);
+  });
+  REQUIRE(entries > 0);
+
+  REQUIRE(image.translate("testcases", "Hello world!") == "Servus Welt!"s);
+  REQUIRE(image.translate("testcases", "I ate {} apple.", "I ate {} apples.", 1)
+          == "Ich habe {} Apfel gegessen."s);
+  REQUIRE(image.translate("testcases", "Goodbye world!") == "Goodbye world!"s);
+  REQUIRE(image.translate("testcases", "Unknown", "Unknowns", 2) == "Unknowns"s);
+  REQUIRE(image.translate("unknown", "Hello world!") == "Hello world!"s);
+  REQUIRE(image.origin("testcases", "Goodbye world!").empty());
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  REQUIRE(hello.in(image).view() == "Servus Welt!"s);
+  REQUIRE(apples.in(image)(2) == "Ich habe 2 Äpfel gegessen.");
+
+  CatalogImage empty;
+  REQUIRE(empty.languages() == "C");
+  REQUIRE(empty.translate("testcases", "Hello world!") == "Hello world!"s);
+}
+
+#if I18N_HAS_MEMFD
+TEST_CASE("catalog images can be shared through a memfd", "[image]") {
+  int fd = CatalogImage::memfd(austrian());
+  CatalogImage image(fd);
+  ::close(fd);
+  REQUIRE(image.translate("testcases", "Hello {}!") == "Hallo {}!"s);
+  REQUIRE(image.origin("testcases", "Hello {}!") == "de_DE");
+}
+#endif
+
+TEST_CASE("invalid catalog images are rejected", "[image]") {
+  std::string image = CatalogImage::compile(austrian());
+  for (std::size_t size : {std::size_t(0), std::size_t(8), image.size() - 1}) {
+    std::ofstream(image_path(), std::ios::binary).write(image.data(), size);
+    REQUIRE_THROWS(CatalogImage(image_path()));
+  }
+  // A string offset beyond the end of the image
+  image[12] = '\xff';
+  std::ofstream(image_path(), std::ios::binary).write(image.data(), image.size());
+  REQUIRE_THROWS_AS(CatalogImage(image_path()), std::runtime_error);
+  std::filesystem::remove(image_path());
+}
+
+TEST_CASE("ImageBackend uses the installed image", "[image]") {
+  CatalogImage::write(austrian(), image_path());
+  static const CatalogImage image(image_path());
+  std::filesystem::remove(image_path());
+
+  REQUIRE(ImageBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+  ImageBackend::set_image(&image);
+  REQUIRE(ImageBackend::translate("testcases", "Hello world!") == "Servus Welt!"s);
+  REQUIRE(ImageBackend::translate(nullptr, "Hello {}!") == "Hallo {}!"s);
+  ImageBackend::set_image(nullptr);
+  REQUIRE(ImageBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+}
@@ -0,0 +1,378 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/mo.hpp>
+#include <i18n/prewarm.hpp>
+#include <i18n/simple.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <locale>
+#include <sstream>
+#include <string>
+
+using namespace std::string_literals;
+using mfk::i18n::CompileTimeI18NString;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::Locale;
+using mfk::i18n::MoBackend;
+using mfk::i18n::MoFile;
+using mfk::i18n::PluralForms;
+
+namespace {
+constexpr CompileTimeString<char, std::size_t(-1)> none;
+using HelloWorld = CompileTimeI18NString<none, none, CompileTimeString("Hello world!"), none>;
+using OpenFile =
+    CompileTimeI18NString<none, CompileTimeString("file"), CompileTimeString("open"), none>;
+
+static_assert(HelloWorld::hash().pjw == mfk::i18n::hash_pjw("Hello world!"));
+static_assert(HelloWorld::hash().fast == mfk::i18n::hash_fast("Hello world!"));
+static_assert(OpenFile::hash().pjw == mfk::i18n::hash_pjw("file\4open"));
+static_assert(OpenFile::hash().fast != HelloWorld::hash().fast);
+static_assert(OpenFile::info().key() == "file\4open");
+static_assert(OpenFile::info().singular_view() == "open");
+} // namespace
+
+TEST_CASE("plural forms are evaluated", "[plural]") {
+  SECTION("default rule") {
+    PluralForms rule;
+    REQUIRE(rule.nplurals() == 2);
+    REQUIRE(rule(1) == 0);
+    REQUIRE(rule(0) == 1);
+    REQUIRE(rule(2) == 1);
+  }
+
+  SECTION("polish") {
+    PluralForms rule("nplurals=3; plural=(n==1 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || "
+                     "n%100>=20) ? 1 : 2);");
+    REQUIRE(rule.nplurals() == 3);
+    REQUIRE(rule(1) == 0);
+    REQUIRE(rule(3) == 1);
+    REQUIRE(rule(5) == 2);
+    REQUIRE(rule(13) == 2);
+    REQUIRE(rule(22) == 1);
+    // Beyond the precomputed table
+    REQUIRE(rule(1001) == 2);
+    REQUIRE(rule(1003) == 1);
+    REQUIRE(rule(1012) == 2);
+  }
+
+  SECTION("arabic") {
+    PluralForms rule("nplurals=6; plural=n==0 ? 0 : n==1 ? 1 : n==2 ? 2 : n%100>=3 && "
+                     "n%100<=10 ? 3 : n%100>=11 ? 4 : 5;");
+    for (unsigned long offset : {0ul, 1000ul}) {
+      REQUIRE(rule(offset + 3) == 3);
+      REQUIRE(rule(offset + 11) == 4);
+      REQUIRE(rule(offset + 100) == 5);
+      REQUIRE(rule(offset + 102) == 5);
+    }
+    REQUIRE(rule(0) == 0);
+    REQUIRE(rule(2) == 2);
+  }
+
+  SECTION("invalid results") {
+    PluralForms rule("nplurals=2; plural=n || !n && n / 0 ? n + 1 : 0;");
+    REQUIRE(rule(0) == 0);
+    REQUIRE(rule(1) == 0);
+    REQUIRE(rule(300) == 0);
+  }
+
+  SECTION("header parsing") {
+    auto rule = PluralForms::from_header("Language: ja\nPlural-Forms: nplurals=1; plural=0;\n");
+    REQUIRE(rule.nplurals() == 1);
+    REQUIRE(rule(1) == 0);
+    REQUIRE(rule(7) == 0);
+    REQUIRE(PluralForms("nplurals= 3; plural= n % 3;").nplurals() == 3);
+
+    const char *malformed = "Plural-Forms: nplurals=3; plural=n +;\n";
+    REQUIRE_THROWS_AS(PluralForms::from_header(malformed), std::invalid_argument);
+    REQUIRE(PluralForms::from_header_or_default(malformed).nplurals() == 2);
+  }
+
+  SECTION("bytecode") {
+    PluralForms rule("nplurals=3; plural=(n==1 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || "
+                     "n%100>=20) ? 1 : 2);");
+    auto bytecode = rule.bytecode();
+    auto loaded   = PluralForms::from_bytecode(bytecode);
+    REQUIRE(loaded.nplurals() == 3);
+    for (unsigned long n = 0; n != 2000; ++n)
+      REQUIRE(loaded(n) == rule(n));
+
+    REQUIRE_THROWS_AS(PluralForms::from_bytecode(bytecode.substr(0, bytecode.size() - 12)),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(PluralForms::from_bytecode(bytecode.substr(0, 7)), std::invalid_argument);
+    // Jumping backwards could loop forever.
+    std::string backwards = PluralForms("nplurals=2; plural=n ? 1 : 0;").bytecode();
+    backwards[4 + 12 + 4] = 0;
+    REQUIRE_THROWS_AS(PluralForms::from_bytecode(backwards), std::invalid_argument);
+  }
+
+  SECTION("deeply nested expressions are rejected while parsing") {
+    auto rule = [](const std::string &expression) {
+      return PluralForms("nplurals=3; plural=" + expression + ";");
+    };
+    REQUIRE(rule(std::string(60, '(') + "n" + std::string(60, ')'))(2) == 2);
+    REQUIRE_THROWS_AS(rule(std::string(100000, '(') + "n"), std::invalid_argument);
+    REQUIRE_THROWS_AS(rule(std::string(100000, '!') + "n"), std::invalid_argument);
+    std::string chain = "n";
+    for (int i = 0; i != 100000; ++i)
+      chain += "?n:n";
+    REQUIRE_THROWS_AS(rule(chain), std::invalid_argument);
+    std::string sum = "n";
+    for (int i = 0; i != 100000; ++i)
+      sum += "+n";
+    REQUIRE_THROWS_AS(rule(sum), std::invalid_argument);
+  }
+}
+
+TEST_CASE(".mo files can be read directly", "[mo]") {
+  MoFile file(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo");
+
+  REQUIRE(file.find("Hello world!") == "Hallo Welt!"s);
+  REQUIRE(file.find("Hello world!", HelloWorld::hash().pjw) == "Hallo Welt!"s);
+  REQUIRE(file.find("Not translated").data() == nullptr);
+  REQUIRE(file.find("Hello planet!") == "Hallo Planet!"s);
+  REQUIRE(file.find_plural("Hello planet!", 1) == "Hallo Planet!"s);
+  REQUIRE(file.find_plural("Hello planet!", 2) == "Hallo Planeten!"s);
+  REQUIRE(file.plural_forms().nplurals() == 2);
+  REQUIRE(file.header().starts_with("Project-Id-Version: i18n_tests"));
+
+  // A hash table without empty slots must not make lookups probe forever.
+  std::ifstream stream(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo", std::ios::binary);
+  std::string full((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  std::uint32_t hash_size, hash_table, one = 1;
+  std::memcpy(&hash_size, full.data() + 20, 4);
+  std::memcpy(&hash_table, full.data() + 24, 4);
+  for (std::uint32_t i = 0; i != hash_size; ++i)
+    std::memcpy(full.data() + hash_table + 4 * i, &one, 4);
+  MoFile corrupted(full.data(), full.size());
+  REQUIRE(corrupted.find("Not translated").data() == nullptr);
+  REQUIRE(corrupted.find("Hello world!") == "Hallo Welt!"s);
+
+  // Like libintl, the default rule is used if the Plural-Forms header is malformed.
+  auto plural = full.find("plural=", full.find("Plural-Forms:"));
+  REQUIRE(plural != full.npos);
+  full[plural + 7] = '#';
+  MoFile malformed(full.data(), full.size());
+  REQUIRE(malformed.find_plural("Hello planet!", 1) == "Hallo Planet!"s);
+  REQUIRE(malformed.find_plural("Hello planet!", 2) == "Hallo Planeten!"s);
+}
+
+TEST_CASE("MoBackend translates without libintl", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::set_language("de_DE.UTF-8");
+
+  REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hallo Welt!"s);
+  REQUIRE(MoBackend::translate("testcases", "I ate {} apple.", "I ate {} apples.", 2)
+          == "Ich habe {} Äpfel gegessen."s);
+  REQUIRE(MoBackend::translate("testcases", "Hello world!", HelloWorld::hash()) == "Hallo Welt!"s);
+  REQUIRE(MoBackend::translate("testcases", "Unknown", "Unknowns", 2) == "Unknowns"s);
+
+  MoBackend::set_language("C");
+  REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+}
+
+TEST_CASE("registered messages are resolved by index", "[mo]") {
+  const mfk::i18n::MessageInfo &info = HelloWorld::info();
+  auto messages                      = mfk::i18n::messages();
+  REQUIRE(info.index() < messages.size());
+  REQUIRE(messages[info.index()] == &info);
+
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  MoBackend::set_language("de_DE.UTF-8");
+  REQUIRE(MoBackend::translate(info) == "Hallo Welt!"s);
+  REQUIRE(MoBackend::translate(OpenFile::info()) == OpenFile::msgid());
+
+  MoBackend::set_language("C");
+  REQUIRE(MoBackend::translate(info) == "Hello world!"s);
+}
+
+TEST_CASE("messages can be translated for explicit locales", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  MoBackend::set_language("C");
+  Locale german = MoBackend::locale("de_DE.UTF-8");
+  Locale untranslated;
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  REQUIRE(std::string_view(hello.in(german)) == "Hallo Welt!");
+  REQUIRE(std::string_view(hello.in(untranslated)) == "Hello world!");
+  REQUIRE(apples.in(german)[1] == "Ich habe {} Apfel gegessen."s);
+  REQUIRE(apples.in(german)(2) == "Ich habe 2 Äpfel gegessen.");
+  REQUIRE(apples.in(untranslated)(2) == "I ate 2 apples.");
+
+  mfk::i18n::I18NStringCrossDomain runtime("testcases", "Hello world!", "Hello world!");
+  REQUIRE(std::string_view(runtime.in(german)) == "Hallo Welt!");
+
+  SECTION("thread specific locales") {
+    REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+    auto previous = MoBackend::set_thread_locale(german);
+    REQUIRE_FALSE(previous);
+    REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hallo Welt!"s);
+    REQUIRE(MoBackend::set_thread_locale(std::nullopt)->languages() == "de_DE.UTF-8");
+    REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+  }
+}
+
+namespace {
+struct DecimalComma : std::numpunct<char> {
+  char do_decimal_point() const override { return ','; }
+};
+// A locale whose format locale is not installed, like de_DE in most test environments.
+struct CommaLocale : Locale {
+  std::locale numbers{std::locale::classic(), new DecimalComma};
+  const std::locale *format_locale() const { return &numbers; }
+};
+} // namespace
+
+TEST_CASE("L specs use the locale of the translation", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  REQUIRE(Locale("C").format_locale() == nullptr);
+  REQUIRE(Locale("xx_XX:C").format_locale() == nullptr);
+  REQUIRE_FALSE(mfk::i18n::detail::std_locale_for("xx_XX:C:POSIX"));
+
+  CommaLocale german{MoBackend::locale("de_DE.UTF-8")};
+  constexpr auto pi = mfk::i18n::build_I18NString<CompileTimeString("pi is {:.4Lf}.")>();
+  REQUIRE(pi.in(german)(3.14159265) == "Pi ist 3,1416.");
+  REQUIRE(pi.in(german).formatted_size(3.14159265) == 14);
+  std::string buffer;
+  pi.in(german).format_to(std::back_inserter(buffer), 3.14159265);
+  REQUIRE(buffer == "Pi ist 3,1416.");
+  // The global locale is not changed.
+  REQUIRE(pi.in(static_cast<const Locale &>(german))(3.14159265) == "Pi ist 3.1416.");
+}
+
+TEST_CASE("runtime strings are not cached by address", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::set_language("de_DE");
+  char buffer[32] = "Hello world!";
+  mfk::i18n::I18NStringCrossDomain message("testcases", buffer, buffer);
+  REQUIRE(message.view() == std::string_view(message));
+  std::strcpy(buffer, "Goodbye world!");
+  REQUIRE(message.view() == "Goodbye world!");
+  MoBackend::set_language("C");
+}
+
+TEST_CASE("fallback chains are merged when loading", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  // de_AT only translates "Hello world!", everything else comes from de_DE.
+  Locale austrian = MoBackend::locale("de_AT:de_DE.UTF-8");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  REQUIRE(hello.in(austrian).view() == "Servus Welt!"s);
+  REQUIRE(apples.in(austrian)(2) == "Ich habe 2 Äpfel gegessen.");
+  REQUIRE(austrian.translate("testcases", "Hello world!") == "Servus Welt!"s);
+  REQUIRE(austrian.translate("testcases", "Hello {}!") == "Hallo {}!"s);
+
+  REQUIRE(austrian.origin(decltype(hello)::info()) == "de_AT");
+  REQUIRE(austrian.origin(decltype(apples)::info()) == "de_DE");
+  REQUIRE(austrian.origin("testcases", "Hello {}!") == "de_DE");
+  REQUIRE(austrian.origin("testcases", "Goodbye world!").empty());
+  REQUIRE(Locale().origin("testcases", "Hello world!").empty());
+
+  std::size_t austrian_entries = 0, entries = 0;
+  austrian.for_each_entry("testcases", [&](std::string_view key, std::string_view translation,
+                                           std::string_view locale) {
+    ++entries;
+    austrian_entries += locale == "de_AT";
+    if (key == "Hello world!") REQUIRE(translation == "Servus Welt!");
+  });
+  REQUIRE(austrian_entries == 2);
+  REQUIRE(entries == mfk::i18n::MoFile(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo").size());
+}
+
+TEST_CASE("catalogs can be loaded asynchronously", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  MoBackend::set_language("C");
+
+  auto austrian = MoBackend::set_language_async("de_AT:de_DE");
+  auto german   = MoBackend::locale_async("de_DE.UTF-8");
+  austrian.get();
+  REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Servus Welt!"s);
+  REQUIRE(MoBackend::locale().origin("testcases", "Hello {}!") == "de_DE");
+  REQUIRE(german.get().translate("testcases", "Hello world!") == "Hallo Welt!"s);
+
+  // Domains are loaded in parallel, but in the same order as synchronously.
+  Locale::Bindings bindings{{"testcases", TEST_SOURCE_DIR}, {"formats", TEST_SOURCE_DIR}};
+  Locale both = Locale::load_async("de_AT:de_DE", bindings, "formats").get();
+  REQUIRE(both.directories() == Locale("de_AT:de_DE", bindings, "formats").directories());
+  REQUIRE(both.translate("testcases", "Hello world!") == "Servus Welt!"s);
+  REQUIRE(both.translate("formats", "Hello {}!") == "Hallo {}!"s);
+
+  auto broken = std::filesystem::temp_directory_path() / "i18n-tests-broken" / "de";
+  std::filesystem::create_directories(broken / "LC_MESSAGES");
+  std::ofstream(broken / "LC_MESSAGES" / "broken.mo") << "not a catalog";
+  auto failed = Locale::load_async("de", {{"broken", broken.parent_path()}});
+  REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+  std::filesystem::remove_all(broken.parent_path());
+
+  MoBackend::reload_async().get();
+  REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Servus Welt!"s);
+
+  // The last request wins, regardless of which load finishes first.
+  for (int i = 0; i != 20; ++i) {
+    auto first  = MoBackend::set_language_async("de_DE");
+    auto second = MoBackend::set_language_async("de_AT:de_DE");
+    MoBackend::bindtextdomain("formats", TEST_SOURCE_DIR);
+    first.get(), second.get();
+    REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Servus Welt!"s);
+    MoBackend::set_language_async("de_DE");
+    MoBackend::set_language("C");
+    MoBackend::reload_async().get();
+    REQUIRE(MoBackend::translate("testcases", "Hello world!") == "Hello world!"s);
+  }
+}
+
+TEST_CASE("translations carry their lengths", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  Locale german = MoBackend::locale("de_DE.UTF-8");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  REQUIRE(hello.in(german).view() == "Hallo Welt!"s);
+  REQUIRE(hello.in(Locale()).view() == "Hello world!"s);
+  REQUIRE(apples.in(german).view(1) == "Ich habe {} Apfel gegessen."s);
+  REQUIRE(apples.in(german).view(2) == "Ich habe {} Äpfel gegessen."s);
+  REQUIRE(apples.in(Locale()).view(2) == "I ate {} apples."s);
+
+  std::ostringstream stream;
+  stream << hello.in(german) << ' ' << hello.in(Locale());
+  REQUIRE(stream.str() == "Hallo Welt! Hello world!");
+  REQUIRE(fmtstd::format("[{:>12}]", hello.in(german)) == "[ Hallo Welt!]");
+
+  // Other types with a view() member are not formatted as messages
+  struct Unrelated {
+    std::string_view view() const { return "unrelated"; }
+  };
+  static_assert(mfk::i18n::detail::viewable<decltype(hello.in(german))>);
+  static_assert(!mfk::i18n::detail::viewable<Unrelated>);
+  static_assert(!mfk::i18n::detail::viewable<std::ostringstream>);
+}
+
+TEST_CASE("prewarming resolves all registered messages", "[mo]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  Locale german = MoBackend::locale("de_DE.UTF-8");
+
+  std::size_t count = 0, untranslated = 0;
+  for (auto *info : mfk::i18n::messages())
+    if (!info->domain) {
+      ++count;
+      untranslated += german.translate(*info).data() == info->msgid;
+    }
+
+  auto result = mfk::i18n::prewarm(nullptr, german);
+  REQUIRE(result.messages == count);
+  REQUIRE(result.untranslated == untranslated);
+  REQUIRE(result.untranslated < result.messages);
+  REQUIRE(result.duration.count() >= 0);
+
+  REQUIRE(mfk::i18n::prewarm(nullptr, Locale()).untranslated == count);
+  REQUIRE(mfk::i18n::prewarm("unused", german).messages == 0);
+  REQUIRE(mfk::i18n::prewarm<mfk::i18n::GettextBackend>(nullptr).messages == count);
+}
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/reload.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+using mfk::i18n::CatalogWatcher;
+using mfk::i18n::MoBackend;
+
+TEST_CASE("catalogs are reloaded when they change", "[reload]") {
+  namespace fs = std::filesystem;
+  auto root    = fs::temp_directory_path() / "i18n-reload-test";
+  fs::remove_all(root);
+  fs::create_directories(root / "de_DE" / "LC_MESSAGES");
+  auto catalog = root / "de_DE" / "LC_MESSAGES" / "reloaded.mo";
+  // Catalogs are replaced like during a deployment, by renaming new files over them.
+  auto replace = [&](const char *source) {
+    fs::copy_file(source, root / "new.mo", fs::copy_options::overwrite_existing);
+    fs::rename(root / "new.mo", catalog);
+  };
+  auto translate = [] { return MoBackend::translate("reloaded", "Hello world!"); };
+
+  replace(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo");
+  MoBackend::bindtextdomain("reloaded", root);
+  MoBackend::set_language("de_DE");
+  REQUIRE(translate() == "Hallo Welt!"s);
+  const char *before = translate().data();
+
+  replace(TEST_SOURCE_DIR "/de_AT/LC_MESSAGES/testcases.mo");
+  REQUIRE(translate() == "Hallo Welt!"s);
+  MoBackend::reload();
+  REQUIRE(translate() == "Servus Welt!"s);
+  // The replaced catalog is still mapped during the grace period.
+  REQUIRE(before == "Hallo Welt!"s);
+
+  {
+    std::atomic<int> errors = 0;
+    CatalogWatcher watcher({.interval = 50ms, .delay = 10ms, .on_error = [&](auto) { ++errors; }});
+    replace(TEST_SOURCE_DIR "/de_DE/LC_MESSAGES/testcases.mo");
+    for (int i = 0; i != 500 && translate() != "Hallo Welt!"s; ++i)
+      std::this_thread::sleep_for(10ms);
+    REQUIRE(translate() == "Hallo Welt!"s);
+    REQUIRE(errors == 0);
+  }
+
+  MoBackend::set_grace_period(0s);
+  MoBackend::set_grace_period(MoBackend::default_grace_period);
+  MoBackend::set_language("C");
+  fs::remove_all(root);
+}
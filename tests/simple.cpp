@@ -76,3 +76,23 @@ TEST_CASE("de locale provides translations", "[translations]") {
     REQUIRE("Ich habe 2 Äpfel gegessen." == std::string("I ate (an|{}) apple(s)."_(2)));
   }
 }
+
+TEST_CASE("formatting into caller provided buffers", "[simple_i18n]") {
+  std::locale::global(std::locale("C"));
+  textdomain("testcases");
+
+  char buffer[32];
+  auto end = "Hello {}!"_.format_to(buffer, "Max");
+  REQUIRE(std::string_view(buffer, end) == "Hello Max!");
+
+  auto result = "I ate {} apple(s)."_.format_to_n(buffer, 8, 2);
+  REQUIRE(result.size == 15);
+  REQUIRE(std::string_view(buffer, result.out) == "I ate 2 ");
+
+  REQUIRE("Hello {}!"_.formatted_size("Max") == 10);
+  REQUIRE("I ate (an|{}) apple(s)."_.formatted_size(1) == 15);
+
+  std::string out;
+  "Hello {}!"_.format_to(std::back_inserter(out), "Max");
+  REQUIRE(out == "Hello Max!");
+}
@@ -0,0 +1,62 @@
+// Built into a separate executable with I18N_STATS enabled, see CMakeLists.txt.
+#include <catch2/catch_test_macros.hpp>
+#include <i18n.hpp>
+#include <i18n/mo.hpp>
+#include <string>
+#include <thread>
+
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::Locale;
+using mfk::i18n::MoBackend;
+
+static_assert(I18N_STATS, "stats.cpp has to be compiled with I18N_STATS");
+
+TEST_CASE("translations are counted per message and locale", "[stats]") {
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  Locale german = MoBackend::locale("de_DE.UTF-8");
+
+  constexpr auto hello  = mfk::i18n::build_I18NString<CompileTimeString("Hello world!")>();
+  constexpr auto apples = mfk::i18n::build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+  const char *untranslated = "Not \"translated\"";
+  mfk::i18n::I18NStringCrossDomain missing("testcases", untranslated, untranslated);
+
+  for (int i = 0; i != 100; ++i)
+    static_cast<void>(hello.in(german).view());
+  std::thread([&] {
+    for (int i = 0; i != 28; ++i)
+      static_cast<void>(hello.in(german).view());
+  }).join();
+  REQUIRE(apples.in(german)(2) == "Ich habe 2 Äpfel gegessen.");
+  REQUIRE(apples.in(Locale())(2) == "I ate 2 apples.");
+  REQUIRE(std::string_view(missing.in(german)) == "Not \"translated\"");
+
+  auto stats = mfk::i18n::stats();
+  auto find  = [&](std::string_view catalog, std::string_view msgid) {
+    for (auto &message : stats.messages)
+      if (message.catalog == catalog && message.msgid == msgid) return message;
+    return mfk::i18n::MessageStats{};
+  };
+  REQUIRE(find("de_DE.UTF-8", "Hello world!").hits == 128);
+  REQUIRE(find("de_DE.UTF-8", "Hello world!").misses == 0);
+  REQUIRE(find("de_DE.UTF-8", "I ate {} apple.").hits == 1);
+  REQUIRE(find("C", "I ate {} apple.").misses == 1);
+  REQUIRE(find("de_DE.UTF-8", "Not \"translated\"").misses == 1);
+  REQUIRE(find("de_DE.UTF-8", "Not \"translated\"").domain == "testcases");
+  // Every 64th call of a thread is timed, the other thread made only 28 lookups.
+  REQUIRE(stats.lookup.count() == 1);
+  REQUIRE(stats.format.count() == 0);
+
+  auto text = stats.text();
+  REQUIRE(text.find("128 0 \"de_DE.UTF-8\" \"\" \"Hello world!\"\n") != text.npos);
+  auto json = stats.json();
+  REQUIRE(json.find("{\"catalog\": \"de_DE.UTF-8\", \"domain\": \"testcases\", \"msgid\": "
+                    "\"Not \\\"translated\\\"\", \"hits\": 0, \"misses\": 1}")
+          != json.npos);
+  REQUIRE(json.find("\"lookup\": {\"sample_rate\": 64, \"buckets\": [") != json.npos);
+
+  mfk::i18n::set_stats_enabled(false);
+  static_cast<void>(hello.in(german).view());
+  REQUIRE(mfk::i18n::stats().messages.size() == stats.messages.size());
+  mfk::i18n::set_stats_enabled(true);
+}
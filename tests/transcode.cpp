@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n.hpp>
+#include <i18n/mo.hpp>
+#include <string>
+
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::Locale;
+using mfk::i18n::MoBackend;
+using mfk::i18n::detail::transcode;
+using mfk::i18n::detail::utf8_string;
+
+namespace {
+constexpr CompileTimeString<char16_t, std::size_t(-1)> none;
+using HelloWorld = mfk::i18n::CompileTimeI18NString<none, none, CompileTimeString(u"Hello world!"),
+                                                    none>;
+} // namespace
+
+static_assert(utf8_string<CompileTimeString(u"Grüße 🌍")>.length == 12);
+static_assert(std::string_view(utf8_string<CompileTimeString(U"Grüße 🌍")>.str) == "Grüße 🌍");
+static_assert(std::string_view(utf8_string<CompileTimeString(L"Grüße 🌍")>.str) == "Grüße 🌍");
+
+TEST_CASE("strings are transcoded from UTF-8", "[transcode]") {
+  REQUIRE(transcode<char16_t>("Grüße 🌍") == u"Grüße 🌍");
+  REQUIRE(transcode<char32_t>("Grüße 🌍") == U"Grüße 🌍");
+  REQUIRE(transcode<wchar_t>("Grüße 🌍") == L"Grüße 🌍");
+  REQUIRE(transcode<char8_t>("Grüße 🌍") == u8"Grüße 🌍");
+  REQUIRE(transcode<char16_t>("a\xff" "b\xe2\x82") == u"a�b�");
+
+  auto &cache      = mfk::i18n::detail::transcoding_cache<char16_t>();
+  std::string text = "Grüße";
+  auto first       = cache.get(text);
+  REQUIRE(first == u"Grüße");
+  text[0] = 'g';
+  REQUIRE(cache.get(text) == u"grüße");
+  REQUIRE(cache.get("Grüße").data() == first.data());
+}
+
+TEST_CASE("messages can use wide character types", "[transcode]") {
+  std::locale::global(std::locale("C"));
+  textdomain("testcases");
+  MoBackend::bindtextdomain("testcases", TEST_SOURCE_DIR);
+  MoBackend::textdomain("testcases");
+  Locale german = MoBackend::locale("de_DE.UTF-8");
+
+  constexpr auto hello   = mfk::i18n::build_I18NString<CompileTimeString(u"Hello world!")>();
+  constexpr auto apples  = mfk::i18n::build_I18NString<CompileTimeString(U"I ate {} apple(s).")>();
+  constexpr auto wapples = mfk::i18n::build_I18NString<CompileTimeString(L"I ate {} apple(s).")>();
+
+  // Wide messages are registered with their UTF-8 strings, so catalogs find them.
+  REQUIRE(HelloWorld::info().key() == "Hello world!");
+  REQUIRE(HelloWorld::hash().fast == mfk::i18n::hash_fast("Hello world!"));
+  REQUIRE(mfk::i18n::messages()[HelloWorld::info().index()] == &HelloWorld::info());
+
+  REQUIRE(std::u16string_view(hello) == u"Hello world!");
+  REQUIRE(hello.view().data() == std::u16string_view(hello).data());
+  REQUIRE(std::u32string_view(apples[2]) == U"I ate {} apples.");
+  REQUIRE(wapples(1) == L"I ate 1 apple.");
+
+  REQUIRE(hello.in(german).view() == u"Hallo Welt!");
+  REQUIRE(hello.in(german).view().data() == hello.in(german).view().data());
+  REQUIRE(apples.in(german).view(2) == U"Ich habe {} Äpfel gegessen.");
+  REQUIRE(wapples.in(german)(2) == L"Ich habe 2 Äpfel gegessen.");
+  REQUIRE(wapples.in(german).formatted_size(2) == 26);
+
+  // Copies of translations are owned by their locale.
+  Locale austrian = MoBackend::locale("de_AT");
+  auto translation = german.translate("testcases", "Hello world!");
+  REQUIRE(german.transcoded<char16_t>(translation).data() == hello.in(german).view().data());
+  REQUIRE(austrian.transcoded<char16_t>(translation) == u"Hallo Welt!");
+  REQUIRE(austrian.transcoded<char16_t>(translation).data() != hello.in(german).view().data());
+}
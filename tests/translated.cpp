@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n/mo.hpp>
+#include <i18n/simple.hpp>
+#include <string>
+
+using namespace std::string_literals;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::build_I18NString;
+using namespace mfk::i18n::literals;
+
+// I18N_BUILD_CATALOG is generated from de_DE/LC_MESSAGES/testcases.po.
+namespace {
+constexpr auto hello   = build_I18NString<CompileTimeString("Hello world!")>();
+constexpr auto apples  = build_I18NString<CompileTimeString("I ate {} apple(s).")>();
+constexpr auto pi      = build_I18NString<CompileTimeString("pi is {:.4Lf}.")>();
+constexpr auto goodbye = build_I18NString<CompileTimeString("Goodbye world!")>();
+
+static_assert(hello.view() == "Hallo Welt!");
+static_assert("Hello world!"_.view() == "Hallo Welt!");
+static_assert(apples.view(1) == "Ich habe {} Apfel gegessen.");
+static_assert(apples.view(2) == "Ich habe {} Äpfel gegessen.");
+static_assert(build_I18NString<CompileTimeString(u"Hello world!")>().view() == u"Hallo Welt!");
+static_assert(build_I18NString<CompileTimeString(L"I ate {} apple(s).")>().view(0)
+              == L"Ich habe {} Äpfel gegessen.");
+} // namespace
+
+TEST_CASE("translations are substituted at compile time", "[translated]") {
+  REQUIRE(hello.view() == "Hallo Welt!"s);
+  REQUIRE(std::string(hello) == "Hallo Welt!");
+  REQUIRE(apples[1] == "Ich habe {} Apfel gegessen."s);
+  REQUIRE(apples(1) == "Ich habe 1 Apfel gegessen.");
+  REQUIRE(apples(3) == "Ich habe 3 Äpfel gegessen.");
+  REQUIRE(pi(3.14159265) == "Pi ist 3.1416.");
+  REQUIRE("I ate {} apple(s)."_(2) == "Ich habe 2 Äpfel gegessen.");
+  REQUIRE("Goodbye world!"_.view() == "Goodbye world!"s);
+  REQUIRE(apples.formatted_size(3) == std::string("Ich habe 3 Äpfel gegessen.").size());
+  REQUIRE(build_I18NString<CompileTimeString(L"I ate {} apple(s).")>()(2)
+          == L"Ich habe 2 Äpfel gegessen.");
+
+  // Messages missing from the catalog and explicit catalogs are translated at runtime.
+  REQUIRE(goodbye.view() == "Goodbye world!"s);
+  REQUIRE(hello.in(mfk::i18n::Locale()).view() == "Hello world!"s);
+}
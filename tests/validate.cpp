@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <i18n.hpp>
+#include <i18n/mo.hpp>
+#include <i18n/validate.hpp>
+#include <locale>
+#include <string>
+
+using namespace std::string_view_literals;
+using mfk::i18n::check_format_translation;
+using mfk::i18n::CompileTimeString;
+using mfk::i18n::Locale;
+using mfk::i18n::detail::format_fields;
+
+static_assert(I18N_VALIDATE_FORMATS, "The tests have to be compiled with I18N_VALIDATE_FORMATS");
+
+TEST_CASE("format strings are split into fields", "[validate]") {
+  auto fields = format_fields("{{{}}} {:>{}.{}f} {:%H:%M}");
+  REQUIRE(fields);
+  REQUIRE(fields->size() == 5);
+  REQUIRE((*fields)[0].arg == 0);
+  REQUIRE((*fields)[1].arg == 1);
+  REQUIRE((*fields)[1].spec == ">{}.{}f");
+  REQUIRE((*fields)[2].arg == 2);
+  REQUIRE((*fields)[2].nested);
+  REQUIRE((*fields)[3].arg == 3);
+  REQUIRE((*fields)[4].spec == "%H:%M");
+
+  REQUIRE(format_fields("{1} {0:x}")->size() == 2);
+  REQUIRE((*format_fields("{name}"))[0].arg == -1);
+  REQUIRE_FALSE(format_fields("{} {0}"));
+  REQUIRE_FALSE(format_fields("{"));
+  REQUIRE_FALSE(format_fields("}"));
+  REQUIRE_FALSE(format_fields("{:{x}"));
+}
+
+TEST_CASE("translations are checked against their originals", "[validate]") {
+  REQUIRE(check_format_translation("Hello {}!", "", "Hallo {}!").empty());
+  REQUIRE(check_format_translation("{} of {}", "", "{1} von {0}").empty());
+  REQUIRE(check_format_translation("{:>8.2f}", "", "{:<10.3}").empty());
+  REQUIRE(check_format_translation("{:%H:%M}", "", "{:%H:%M}").empty());
+  REQUIRE(check_format_translation("I ate {} apple.", "I ate {} apples.",
+                                   "Einen Apfel\0{} Äpfel"sv)
+              .empty());
+  // Not a format string
+  REQUIRE(check_format_translation("Hello world!", "", "Hallo {Welt}!").empty());
+
+  REQUIRE(check_format_translation("Hello {}!", "", "Hallo {!") == "is not a valid format string");
+  REQUIRE(check_format_translation("{} of {}", "", "{2} von {0}")
+          == "uses argument 2, which the original does not use");
+  REQUIRE(check_format_translation("{:.4Lf}", "", "{:d}")
+          == "uses an incompatible format spec for argument 0");
+  REQUIRE(check_format_translation("{}", "", "{:+}")
+          == "uses an incompatible format spec for argument 0");
+  REQUIRE(check_format_translation("{:%H:%M}", "", "{:%H}")
+          == "uses an incompatible format spec for argument 0");
+  REQUIRE(check_format_translation("{}", "", "{name}") == "uses a named argument");
+  REQUIRE(check_format_translation("Missing {}", "", "Fehlt") == "does not use argument 0");
+  REQUIRE(check_format_translation("{} file", "{} files", "{} Datei\0{"sv)
+          == "form 1 is not a valid format string");
+}
+
+TEST_CASE("invalid translations are rejected when loading", "[validate]") {
+  std::locale::global(std::locale("C"));
+  Locale german("de_DE", {{"formats", TEST_SOURCE_DIR}}, "formats");
+
+  auto &errors = german.format_errors();
+  REQUIRE(errors.size() == 4);
+  for (auto &error : errors) {
+    REQUIRE(error.domain == "formats");
+    REQUIRE(error.locale == "de_DE");
+  }
+  REQUIRE(errors[0].key == "Missing {}");
+  REQUIRE(errors[0].reason == "does not use argument 0");
+  REQUIRE(errors[1].key == "pi is {:.4Lf}.");
+  REQUIRE(errors[2].key == "{} file");
+  REQUIRE(errors[3].key == "{} of {}");
+
+  REQUIRE(german.translate("formats", "Hello world!") == "Hallo {Welt}!");
+  REQUIRE(german.translate("formats", "{1} of {0}") == "{1} von {0}");
+  REQUIRE(german.translate("formats", "{} of {}") == "{} of {}");
+  REQUIRE(german.translate("formats", "{} file", "{} files", 2) == "{} files");
+  REQUIRE(german.translate("formats", "I ate {} apple.", "I ate {} apples.", 2)
+          == "Ich habe {} Äpfel gegessen.");
+  REQUIRE(german.origin("formats", "{} of {}").empty());
+
+  // Rejected translations of literals fall back to the original as well.
+  constexpr auto hello = mfk::i18n::build_I18NString<CompileTimeString("Hello {}!")>();
+  constexpr auto pi    = mfk::i18n::build_I18NString<CompileTimeString("pi is {:.4Lf}.")>();
+  REQUIRE(hello.in(german)("Max") == "Hallo Max!");
+  REQUIRE(pi.in(german)(3.14159265) == "pi is 3.1416.");
+}